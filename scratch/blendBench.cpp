@@ -0,0 +1,77 @@
+/**
+ * Time the blend kernels on rows, and blended fills against replacing ones
+ *
+ * Usage: blendBench [width height]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "Canvas.hpp"
+#include "primitives/Rect.hpp"
+#include "utils/blendRow.hpp"
+
+using namespace pixedit;
+
+template<class DRAW>
+static double
+measure(DRAW draw)
+{
+  constexpr int RUNS = 10;
+  double best = 1e9;
+  for (int i = 0; i < RUNS; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    draw();
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+int
+main(int argc, char** argv)
+{
+  int w = argc > 2 ? std::atoi(argv[1]) : 3840;
+  int h = argc > 2 ? std::atoi(argv[2]) : 2160;
+  std::cout << "Blending " << w << "x" << h << "\n";
+  const double pixels = double(w) * h;
+
+  const char* modeNames[] = {"replace", "over", "multiply", "add"};
+  const char* kernelNames[] = {"scalar", "sse2", "avx2"};
+  std::vector<Uint32> dst(size_t(w) * h, 0x80604020);
+  std::vector<Uint32> src(w, 0x204080A0);
+  for (auto mode :
+       {BlendMode::SOURCE_OVER, BlendMode::MULTIPLY, BlendMode::ADD}) {
+    for (auto kernel :
+         {BlendKernel::SCALAR, BlendKernel::SSE2, BlendKernel::AVX2}) {
+      if (!isSupported(kernel)) continue;
+      double ms = measure([&] {
+        for (int y = 0; y < h; ++y) {
+          blendRow(&dst[size_t(y) * w], src.data(), w, mode, 24, kernel);
+        }
+      });
+      std::cout << modeNames[int(mode)] << " rows, "
+                << kernelNames[int(kernel)] << ": " << ms << "ms, "
+                << pixels / ms / 1000 << " Mpixel/s\n";
+    }
+  }
+
+  Canvas canvas{Surface::create(w, h)};
+  canvas | Color{255, 128, 0, 160} | ColorB{0, 0, 0, 255};
+  canvas.setParallelFill({1, 0});
+  for (auto mode : {BlendMode::REPLACE,
+                    BlendMode::SOURCE_OVER,
+                    BlendMode::MULTIPLY,
+                    BlendMode::ADD}) {
+    canvas | mode;
+    for (auto pattern : {patterns::SOLID, patterns::CHECKERED_4}) {
+      canvas | pattern;
+      double ms = measure([&] { canvas | FillRect(1, 1, w, h); });
+      std::cout << modeNames[int(mode)]
+                << (pattern.data8x8 ? " patterned" : " solid")
+                << " rect: " << ms << "ms\n";
+    }
+  }
+  return 0;
+}
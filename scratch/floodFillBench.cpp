@@ -0,0 +1,119 @@
+/**
+ * Compare the scanline floodFill against the old per pixel one, and time
+ * the tolerance and replace all modes
+ *
+ * Usage: floodFillBench [width height]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "Surface.hpp"
+#include "tools/FloodFillTool.hpp"
+
+using namespace pixedit;
+
+/// @brief The previous implementation, one stack entry per neighbor
+static SDL_Rect
+floodFillPerPixel(Surface surface, const SDL_Point& p, RawColor color)
+{
+  const int WW = surface.getW();
+  const int HH = surface.getH();
+  if (p.x < 0 || p.y < 0 || p.x >= WW || p.y >= HH) { return {0, 0, 0, 0}; }
+
+  auto BPP = surface.getFormat()->BytesPerPixel;
+  auto prevColor = surface.getPixel(p.x, p.y);
+  if (prevColor == color) { return {0, 0, 0, 0}; }
+  std::vector<SDL_Point> stack{p};
+  int x0 = p.x, y0 = p.y, x1 = p.x, y1 = p.y;
+
+  while (!stack.empty()) {
+    auto p = stack.back();
+    stack.pop_back();
+
+    auto pixelPtr = surface.pixel(p.x, p.y);
+    auto c = getPixel(pixelPtr, BPP);
+    if (c != prevColor) continue;
+    setPixel(pixelPtr, color, BPP);
+    x0 = std::min(x0, p.x);
+    x1 = std::max(x1, p.x);
+    y0 = std::min(y0, p.y);
+    y1 = std::max(y1, p.y);
+
+    if (p.x > 0) stack.emplace_back(p.x - 1, p.y);
+    if (p.x < WW - 1) stack.emplace_back(p.x + 1, p.y);
+    if (p.y > 0) stack.emplace_back(p.x, p.y - 1);
+    if (p.y < HH - 1) stack.emplace_back(p.x, p.y + 1);
+  }
+  return {x0, y0, x1 - x0 + 1, y1 - y0 + 1};
+}
+
+static Surface
+makeScene(int w, int h)
+{
+  auto surface = Surface::create(w, h);
+  surface.fillRect({0, 0, w, h}, 0);
+  // Some pillars and bars, so the fill has to turn around them
+  for (int x = 37; x < w; x += 97) {
+    surface.fillRect({x, (x / 97) % 2 ? 0 : 40, 3, h - 40}, 0xFF);
+  }
+  for (int y = 53; y < h; y += 131) {
+    surface.fillRect({0, y, w / 3, 2}, 0xFF);
+  }
+  return surface;
+}
+
+template<class FILL>
+static double
+measure(const char* name, int w, int h, FILL fill)
+{
+  constexpr int RUNS = 5;
+  double best = 1e9;
+  for (int i = 0; i < RUNS; ++i) {
+    auto surface = makeScene(w, h);
+    auto start = std::chrono::steady_clock::now();
+    fill(surface, SDL_Point{w / 2, h / 2}, 0xFFFF'FFFF);
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  std::cout << name << ": " << best << "ms\n";
+  return best;
+}
+
+int
+main(int argc, char** argv)
+{
+  int w = argc > 2 ? std::atoi(argv[1]) : 3840;
+  int h = argc > 2 ? std::atoi(argv[2]) : 2160;
+  std::cout << "Filling " << w << "x" << h << "\n";
+
+  auto expected = makeScene(w, h);
+  auto actual = makeScene(w, h);
+  floodFillPerPixel(expected, {w / 2, h / 2}, 0xFFFF'FFFF);
+  floodFill(actual, {w / 2, h / 2}, 0xFFFF'FFFF);
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      if (expected.getPixel(x, y) != actual.getPixel(x, y)) {
+        std::cout << "Mismatch at " << x << "x" << y << "\n";
+        return 1;
+      }
+    }
+  }
+
+  auto before = measure("per pixel", w, h, floodFillPerPixel);
+  auto after = measure("scanline", w, h, [](auto... args) {
+    return floodFill(args...);
+  });
+  std::cout << "speedup: " << before / after << "x\n";
+  measure("scanline, tolerance 8", w, h, [](auto... args) {
+    return floodFill(args..., 8);
+  });
+  measure("replace all", w, h, [](auto... args) {
+    return floodFill(args..., 0, false);
+  });
+  measure("replace all, tolerance 8", w, h, [](auto... args) {
+    return floodFill(args..., 8, false);
+  });
+  return 0;
+}
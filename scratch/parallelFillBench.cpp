@@ -0,0 +1,82 @@
+/**
+ * Time large fills on an 8K canvas, painted as one band and split in bands
+ * on the worker pool
+ *
+ * Usage: parallelFillBench [threads]
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "Canvas.hpp"
+#include "primitives/Oval.hpp"
+#include "primitives/Poly.hpp"
+#include "primitives/Rect.hpp"
+#include "utils/WorkerPool.hpp"
+
+using namespace pixedit;
+
+constexpr int W = 7680;
+constexpr int H = 4320;
+
+template<class DRAW>
+static double
+measure(Canvas& canvas, DRAW draw)
+{
+  constexpr int RUNS = 5;
+  double best = 1e9;
+  for (int i = 0; i < RUNS; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    draw(canvas);
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+template<class DRAW>
+static void
+compare(const char* name, Canvas& canvas, unsigned threads, DRAW draw)
+{
+  canvas.setParallelFill({1, 0});
+  auto before = measure(canvas, draw);
+  canvas.setParallelFill({threads, ParallelFill::fromDefaults().cutoff});
+  auto after = measure(canvas, draw);
+  std::cout << name << ": " << before << "ms -> " << after << "ms ("
+            << before / after << "x)\n";
+}
+
+int
+main(int argc, char** argv)
+{
+  unsigned threads = argc > 1 ? std::atoi(argv[1])
+                              : WorkerPool::shared().getThreadCount();
+  std::cout << "Filling " << W << "x" << H << " with " << threads
+            << " bands, " << WorkerPool::shared().getThreadCount()
+            << " threads\n";
+  auto surface = Surface::create(W, H);
+  Canvas canvas{surface};
+  canvas | RawColorA(0xFFFF'FFFF) | RawColorB(0x0000'00FF);
+
+  compare("rect", canvas, threads, [](Canvas& c) {
+    c | Pattern{0} | FillRect(0, 0, W, H);
+  });
+  compare("patterned rect", canvas, threads, [](Canvas& c) {
+    c | patterns::CHECKERED_4 | FillRect(0, 0, W, H);
+  });
+  compare("oval", canvas, threads, [](Canvas& c) {
+    c | Pattern{0} | FillOval(0, 0, W, H);
+  });
+  std::vector<SDL_Point> star;
+  for (int i = 0; i < 10; ++i) {
+    int r = i % 2 ? H / 5 : H / 2;
+    star.push_back({W / 2 + int(r * std::sin(i * M_PI / 5)),
+                    H / 2 - int(r * std::cos(i * M_PI / 5))});
+  }
+  compare("polygon", canvas, threads, [&](Canvas& c) {
+    c | patterns::CHECKERED_4 | FillPoly(star);
+  });
+  return 0;
+}
@@ -0,0 +1,51 @@
+/**
+ * Time patterned fills against solid ones
+ *
+ * Usage: patternFillBench [width height]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "Canvas.hpp"
+#include "primitives/Oval.hpp"
+#include "primitives/Rect.hpp"
+
+using namespace pixedit;
+
+template<class DRAW>
+static void
+measure(const char* name, Canvas& canvas, DRAW draw)
+{
+  constexpr int RUNS = 10;
+  double best = 1e9;
+  for (int i = 0; i < RUNS; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    draw(canvas);
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  std::cout << name << ": " << best << "ms\n";
+}
+
+int
+main(int argc, char** argv)
+{
+  int w = argc > 2 ? std::atoi(argv[1]) : 3840;
+  int h = argc > 2 ? std::atoi(argv[2]) : 2160;
+  std::cout << "Filling " << w << "x" << h << "\n";
+  Canvas canvas{Surface::create(w, h)};
+  canvas | Color{255, 255, 255, 255} | ColorB{0, 0, 0, 255};
+
+  canvas | patterns::SOLID;
+  measure("solid rect", canvas, [&](Canvas& c) { c | FillRect(1, 1, w, h); });
+  measure("solid oval", canvas, [&](Canvas& c) { c | FillOval{1, 1, w, h}; });
+  canvas | patterns::CHECKERED_4;
+  measure("patterned rect", canvas, [&](Canvas& c) {
+    c | FillRect(1, 1, w, h);
+  });
+  measure("patterned oval", canvas, [&](Canvas& c) {
+    c | FillOval{1, 1, w, h};
+  });
+  return 0;
+}
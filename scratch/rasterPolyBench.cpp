@@ -0,0 +1,125 @@
+/**
+ * Compare the edge table rasterPoly against the old one that walked every
+ * edge on every row, on polygons like the ones free selections make
+ *
+ * Usage: rasterPolyBench [vertices]
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <tuple>
+#include <vector>
+#include "utils/rasterPoly.hpp"
+
+using namespace pixedit;
+
+/// @brief The previous implementation
+template<std::invocable<int, int, int> CALLBACK>
+void
+rasterPolyPerEdge(std::span<const int> points, CALLBACK callback)
+{
+  auto count = points.size() / 2;
+  if (count < 3) return;
+  int minY = points[1], maxY = points[1];
+  for (size_t i = 1; i < count; ++i) {
+    int curr = points[i * 2 + 1];
+    if (curr < minY) minY = curr;
+    if (curr > maxY) maxY = curr;
+  }
+  std::vector<int> ints;
+  for (int y = minY; y <= maxY; ++y) {
+    ints.clear();
+    for (size_t i = 0; i < count; ++i) {
+      int ind1 = i > 0 ? i - 1 : count - 1;
+      int ind2 = i;
+      int x1 = points[ind1 * 2];
+      int y1 = points[ind1 * 2 + 1];
+      int x2 = points[ind2 * 2];
+      int y2 = points[ind2 * 2 + 1];
+      if (y1 > y2) {
+        std::swap(x1, x2);
+        std::swap(y1, y2);
+      } else if (y1 == y2) {
+        continue;
+      }
+      if (((y >= y1) && (y < y2)) || ((y == maxY) && (y > y1) && (y <= y2))) {
+        ints.push_back(((65536 * (y - y1)) / (y2 - y1)) * (x2 - x1) +
+                       (65536 * x1));
+      }
+    }
+    std::sort(ints.begin(), ints.end());
+    for (size_t i = 0; i < ints.size(); i += 2) {
+      int xA = ints[i] + 1;
+      xA = (xA >> 16) + ((xA & 32768) >> 15);
+      int xB = ints[i + 1] - 1;
+      xB = (xB >> 16) + ((xB & 32768) >> 15);
+      callback(xA, y, xB - xA + 1);
+    }
+  }
+}
+
+/// @brief A wobbly ring, like a lasso drawn by hand
+static std::vector<int>
+makeLasso(int vertices)
+{
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<double> noise{-40, 40};
+  std::vector<int> points;
+  for (int i = 0; i < vertices; ++i) {
+    double angle = 2 * M_PI * i / vertices;
+    double radius = 900 + noise(rng) + 200 * std::sin(angle * 7);
+    points.push_back(1100 + int(radius * std::cos(angle)));
+    points.push_back(1100 + int(radius * std::sin(angle)));
+  }
+  return points;
+}
+
+template<class RASTER>
+static double
+measure(const char* name, const std::vector<int>& points, RASTER raster)
+{
+  constexpr int RUNS = 5;
+  double best = 1e9;
+  for (int i = 0; i < RUNS; ++i) {
+    long long total = 0;
+    auto start = std::chrono::steady_clock::now();
+    raster(points, [&](int x, int y, int len) { total += len; });
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  std::cout << name << ": " << best << "ms\n";
+  return best;
+}
+
+int
+main(int argc, char** argv)
+{
+  int vertices = argc > 1 ? std::atoi(argv[1]) : 5000;
+  std::cout << "Polygon of " << vertices << " vertices\n";
+  auto points = makeLasso(vertices);
+
+  using HLine = std::tuple<int, int, int>;
+  std::vector<HLine> expected, actual;
+  rasterPolyPerEdge(std::span<const int>{points}, [&](int x, int y, int len) {
+    expected.emplace_back(x, y, len);
+  });
+  rasterPoly(std::span<const int>{points}, [&](int x, int y, int len) {
+    actual.emplace_back(x, y, len);
+  });
+  if (expected != actual) {
+    std::cout << "Spans differ\n";
+    return 1;
+  }
+
+  auto before = measure("per edge", points, [](auto& p, auto cb) {
+    rasterPolyPerEdge(std::span<const int>{p}, cb);
+  });
+  auto after = measure("edge table", points, [](auto& p, auto cb) {
+    rasterPoly(std::span<const int>{p}, cb);
+  });
+  std::cout << "speedup: " << before / after << "x\n";
+  return 0;
+}
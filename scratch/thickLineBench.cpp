@@ -0,0 +1,51 @@
+/**
+ * Compare drawing thick lines as one pen box per point against PenStroke
+ *
+ * Usage: thickLineBench [pen size]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "Canvas.hpp"
+#include "primitives/Line.hpp"
+#include "utils/rasterLine.hpp"
+
+using namespace pixedit;
+
+template<class DRAW>
+static double
+measure(const char* name, DRAW draw)
+{
+  constexpr int RUNS = 5;
+  double best = 1e9;
+  auto surface = Surface::create(2048, 2048);
+  Canvas canvas{surface};
+  for (int i = 0; i < RUNS; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    for (int j = 0; j < 64; ++j) draw(canvas, j * 31, 0, 2047 - j * 17, 2047);
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  std::cout << name << ": " << best << "ms\n";
+  return best;
+}
+
+int
+main(int argc, char** argv)
+{
+  int size = argc > 1 ? std::atoi(argv[1]) : 16;
+  std::cout << "64 lines with a " << size << "x" << size << " pen\n";
+  auto setup = [&](Canvas& c) { c | RawColorA(0xFFFF'FFFF) | Pen{size, size}; };
+
+  auto before = measure("box per point", [&](Canvas& c, auto... args) {
+    setup(c);
+    rasterLine(args..., [&](int x, int y) { c | SDL_Point{x, y}; });
+  });
+  auto after = measure("stroke", [&](Canvas& c, auto... args) {
+    setup(c);
+    c | LineTo(args...);
+  });
+  std::cout << "speedup: " << before / after << "x\n";
+  return 0;
+}
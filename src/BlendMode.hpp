@@ -0,0 +1,23 @@
+#ifndef PIXEDIT_SRC_BLEND_MODE_INCLUDED
+#define PIXEDIT_SRC_BLEND_MODE_INCLUDED
+
+namespace pixedit {
+
+/**
+ * How the brush colors are put on the pixels under them
+ *
+ * Except for REPLACE, the color is weighted by its alpha, so a translucent
+ * brush lets the pixels show through, and the alpha of the result is the
+ * one of the brush composited over the pixel one.
+ */
+enum class BlendMode
+{
+  REPLACE,     ///< Overwrite the pixels, alpha included
+  SOURCE_OVER, ///< Paint the color over the pixels
+  MULTIPLY,    ///< Darken the pixels by the color
+  ADD,         ///< Lighten the pixels by the color, saturating at white
+};
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_BLEND_MODE_INCLUDED */
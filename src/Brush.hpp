@@ -2,6 +2,7 @@
 #define PIXEDIT_SRC_BRUSH_INCLUDED
 
 #include <SDL.h>
+#include "BlendMode.hpp"
 #include "Pattern.hpp"
 #include "Pen.hpp"
 #include "utils/Color.hpp"
@@ -15,6 +16,7 @@ struct Brush
   RawColor colorB{};
   Pen pen;
   Pattern pattern{patterns::SOLID};
+  BlendMode blendMode{BlendMode::REPLACE};
 };
 
 } // namespace pixedit
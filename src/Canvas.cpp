@@ -1,11 +1,29 @@
 #include "Canvas.hpp"
+#include <algorithm>
+#include <climits>
+#include "CanvasCommandList.hpp"
+#include "Stamp.hpp"
 #include "primitives/Blit.hpp"
 #include "primitives/Line.hpp"
-#include "utils/pixel.hpp"
+#include "primitives/PenStroke.hpp"
+#include "utils/SurfaceView.hpp"
+#include "utils/WorkerPool.hpp"
+#include "utils/blendRow.hpp"
 #include "utils/rasterLine.hpp"
 
 namespace pixedit {
 
+namespace defaults {
+extern const unsigned PARALLEL_FILL_THREADS;
+extern const size_t PARALLEL_FILL_CUTOFF;
+} // namespace defaults
+
+ParallelFill
+ParallelFill::fromDefaults()
+{
+  return {defaults::PARALLEL_FILL_THREADS, defaults::PARALLEL_FILL_CUTOFF};
+}
+
 void
 Canvas::setSurface(Surface value)
 {
@@ -17,6 +35,67 @@ Canvas::setSurface(Surface value)
   surface = value;
 }
 
+SDL_Rect
+Canvas::getClipRect() const
+{
+  SDL_Rect bounds{0, 0, surface.getW(), surface.getH()};
+  if (clipping && !SDL_IntersectRect(&bounds, &clipRect, &bounds)) {
+    return {0, 0, 0, 0};
+  }
+  return bounds;
+}
+
+SDL_Rect
+Canvas::getPenClipRect() const
+{
+  if (recording && !clipping) return NO_CLIP;
+  auto clip = recording ? clipRect : getClipRect();
+  if (SDL_RectEmpty(&clip)) return {0, 0, 0, 0};
+  auto& pen = brush.pen;
+  if (pen.type != Pen::DOT) {
+    clip.x -= pen.w - pen.w / 2 - pen.w % 2;
+    clip.y -= pen.h - pen.h / 2 - pen.h % 2;
+    clip.w += pen.w - 1;
+    clip.h += pen.h - 1;
+  }
+  return clip;
+}
+
+void
+Canvas::markDirty(SDL_Rect rect)
+{
+  auto clip = getClipRect();
+  if (!SDL_IntersectRect(&rect, &clip, &rect)) return;
+  if (SDL_RectEmpty(&dirtyRect)) {
+    dirtyRect = rect;
+  } else {
+    SDL_UnionRect(&dirtyRect, &rect, &dirtyRect);
+  }
+}
+
+bool
+Canvas::record(SDL_Rect rect)
+{
+  if (!recording) return false;
+  // Lists may be replayed on bigger surfaces, so only the clip rect applies
+  if (clipping && !SDL_IntersectRect(&rect, &clipRect, &rect)) return true;
+  recording->addFill(brush, surface.getFormat(), rect);
+  return true;
+}
+
+/// @brief The area covered by the pen centered at the given rect
+static SDL_Rect
+penArea(const Pen& pen, SDL_Rect rect)
+{
+  if (pen.type != Pen::DOT) {
+    rect.x -= pen.w / 2 + pen.w % 2 - 1;
+    rect.y -= pen.h / 2 + pen.h % 2 - 1;
+    rect.w += pen.w - 1;
+    rect.h += pen.h - 1;
+  }
+  return rect;
+}
+
 Canvas&
 operator|(Canvas& c, Color color)
 {
@@ -30,105 +109,485 @@ operator|(Canvas& c, ColorB color)
   return c;
 }
 
+/// @brief Pixels of a pattern row expanded at once, in whole periods of 8
+constexpr int PATTERN_RUN = 64;
+
+/// @brief Put len pixels of src on dst, as mode says
+template<class PIXEL>
+static void
+blendPixels(PIXEL* dst,
+            const PIXEL* src,
+            int len,
+            BlendMode mode,
+            const SDL_PixelFormat* format)
+{
+  if (mode == BlendMode::REPLACE) {
+    std::copy_n(src, len, dst);
+    return;
+  }
+  if constexpr (std::is_same_v<PIXEL, Uint32>) {
+    if (const int alphaShift = alphaShiftOf(format); alphaShift >= 0) {
+      blendRow(dst, src, len, mode, alphaShift);
+      return;
+    }
+  }
+  for (int i = 0; i < len; ++i) {
+    Color d = rawToComponent(toRaw(dst[i]), format);
+    Color s = rawToComponent(toRaw(src[i]), format);
+    dst[i] = toPixel<PIXEL>(componentToRaw(blendColor(d, s, mode), format));
+  }
+}
+
+/// @brief Put the opaque runs of stamp with its top left at (x, y)
+template<class PIXEL>
+static void
+stampAt(SurfaceView<PIXEL> view,
+        SurfaceView<PIXEL> pixels,
+        const Stamp& stamp,
+        BlendMode mode,
+        int x,
+        int y,
+        const SDL_Rect& clip)
+{
+  const int rowBegin = std::max(0, clip.y - y);
+  const int rowEnd = std::min(stamp.getH(), clip.y + clip.h - y);
+  for (int row = rowBegin; row < rowEnd; ++row) {
+    PIXEL* dst = view.row(y + row) + x;
+    const PIXEL* src = pixels.row(row);
+    for (auto& run : stamp.getRuns(row)) {
+      int x0 = std::max(run.x, clip.x - x);
+      int x1 = std::min(run.x + run.len, clip.x + clip.w - x);
+      if (x0 < x1) {
+        blendPixels(dst + x0, src + x0, x1 - x0, mode, view.getFormat());
+      }
+    }
+  }
+}
+
+/// @brief Blend the brush colors and pattern on rect, already clipped
+template<class PIXEL>
+static void
+blendArea(SurfaceView<PIXEL> view, const Brush& b, const SDL_Rect& rect)
+{
+  const auto format = view.getFormat();
+  const Color colorA = rawToComponent(b.colorA, format);
+  const Color colorB = rawToComponent(b.colorB, format);
+  const int yEnd = rect.y + rect.h;
+  auto patternRow = [&](int y) -> Uint8 {
+    return b.pattern.data8x8 >> (y % 8 * 8);
+  };
+  if constexpr (std::is_same_v<PIXEL, Uint32>) {
+    if (const int alphaShift = alphaShiftOf(format); alphaShift >= 0) {
+      // The kernels read alpha in place, so give it even if format has none
+      auto withAlpha = [&](RawColor raw, Color c) {
+        return (raw & ~(0xFFu << alphaShift)) | Uint32(c.a) << alphaShift;
+      };
+      const Uint32 pixelA = withAlpha(b.colorA, colorA);
+      const Uint32 pixelB = withAlpha(b.colorB, colorB);
+      // Expanded as in fillArea(), only as much as the rows need
+      Uint32 expanded[8][PATTERN_RUN + 8];
+      const int count = std::min(rect.w, PATTERN_RUN) + 8;
+      for (int y = rect.y; y < std::min(yEnd, rect.y + 8); ++y) {
+        Uint8 bits = patternRow(y);
+        auto dst = expanded[y % 8];
+        for (int i = 0; i < count; ++i) {
+          dst[i] = (bits >> (i % 8)) & 1 ? pixelB : pixelA;
+        }
+      }
+      for (int y = rect.y; y < yEnd; ++y) {
+        const Uint32* src = expanded[y % 8] + rect.x % 8;
+        Uint32* dst = view.row(y) + rect.x;
+        for (int left = rect.w; left > 0; left -= PATTERN_RUN) {
+          int len = std::min(left, PATTERN_RUN);
+          blendRow(dst, src, len, b.blendMode, alphaShift);
+          dst += len;
+        }
+      }
+      return;
+    }
+  }
+  // Other formats go through the components, a pixel at a time
+  for (int y = rect.y; y < yEnd; ++y) {
+    auto row = view.row(y);
+    Uint8 bits = patternRow(y);
+    for (int x = rect.x; x < rect.x + rect.w; ++x) {
+      Color dst = rawToComponent(toRaw(row[x]), format);
+      Color src = (bits >> (x % 8)) & 1 ? colorB : colorA;
+      row[x] = toPixel<PIXEL>(
+        componentToRaw(blendColor(dst, src, b.blendMode), format));
+    }
+  }
+}
+
+/**
+ * Paint rect with the brush colors and pattern, clipped to clip
+ *
+ * The clip must be inside the view. Nothing after clipping is checked, so
+ * the loops only see the visible pixels.
+ */
+template<class PIXEL>
+static void
+fillArea(SurfaceView<PIXEL> view,
+         const Brush& b,
+         SDL_Rect rect,
+         const SDL_Rect& clip)
+{
+  // Clipped by hand, as this runs once per span of a stroke
+  const int x0 = std::max(rect.x, clip.x);
+  const int y0 = std::max(rect.y, clip.y);
+  const int x1 = std::min(rect.x + rect.w, clip.x + clip.w);
+  const int y1 = std::min(rect.y + rect.h, clip.y + clip.h);
+  if (x0 >= x1 || y0 >= y1) return;
+  rect = {x0, y0, x1 - x0, y1 - y0};
+  if (b.blendMode != BlendMode::REPLACE) {
+    blendArea(view, b, rect);
+    return;
+  }
+  const auto colorA = toPixel<PIXEL>(b.colorA);
+  const auto colorB = toPixel<PIXEL>(b.colorB);
+  const int yEnd = rect.y + rect.h;
+  if (!b.pattern.data8x8) {
+    for (int y = rect.y; y < yEnd; ++y) view.fill(rect.x, y, rect.w, colorA);
+    return;
+  }
+  auto patternRow = [&](int y) -> Uint8 {
+    return b.pattern.data8x8 >> (y % 8 * 8);
+  };
+  if (rect.w * rect.h <= PATTERN_RUN) {
+    // Too small to pay for expanding the rows
+    for (int y = rect.y; y < yEnd; ++y) {
+      auto row = view.row(y);
+      Uint8 bits = patternRow(y);
+      for (int x = rect.x; x < rect.x + rect.w; ++x) {
+        row[x] = (bits >> (x % 8)) & 1 ? colorB : colorA;
+      }
+    }
+    return;
+  }
+
+  // Expand each pattern row once into colors, with room for any start phase,
+  // so every scanline is just a few copies from it
+  PIXEL expanded[8][PATTERN_RUN + 8];
+  for (int y = rect.y; y < std::min(yEnd, rect.y + 8); ++y) {
+    Uint8 bits = patternRow(y);
+    auto dst = expanded[y % 8];
+    for (int i = 0; i < PATTERN_RUN + 8; ++i) {
+      dst[i] = (bits >> (i % 8)) & 1 ? colorB : colorA;
+    }
+  }
+  for (int y = rect.y; y < yEnd; ++y) {
+    const PIXEL* src = expanded[y % 8] + rect.x % 8;
+    PIXEL* dst = view.row(y) + rect.x;
+    for (int left = rect.w; left > 0; left -= PATTERN_RUN) {
+      dst = std::copy_n(src, std::min(left, PATTERN_RUN), dst);
+    }
+  }
+}
+
+/// @brief How many bands to split a fill of work pixels inside area in
+static int
+bandCount(const ParallelFill& parallel, const SDL_Rect& area, size_t work)
+{
+  if (work < parallel.cutoff || area.h < 2) return 1;
+  unsigned threads = parallel.threads;
+  if (threads == 0) threads = WorkerPool::shared().getThreadCount();
+  return std::min(int(threads), area.h);
+}
+
+/**
+ * Call paint(view, band) for each of count bands of area, on the workers
+ *
+ * The bands split the rows of area evenly and never overlap, so each paint
+ * call must only write inside its band.
+ */
+template<class PAINT>
+static void
+paintBands(Surface surface, SDL_Rect area, int count, PAINT paint)
+{
+  visitSurface(surface.get(), [&](auto view) {
+    WorkerPool::shared().run(count, [&](int i) {
+      int y0 = area.y + area.h * i / count;
+      int y1 = area.y + area.h * (i + 1) / count;
+      paint(view, SDL_Rect{area.x, y0, area.w, y1 - y0});
+    });
+  });
+}
+
 void
-doPixel(Surface surface, const Brush& b, SDL_Point p)
+Canvas::fill(SDL_Rect rect)
 {
-  auto color = b.colorA;
-  if (b.pattern.data8x8) {
-    int xx = p.x % 8;
-    int yy = p.y % 8;
-    if ((b.pattern.data8x8 >> (yy * 8 + xx)) & 1) { color = b.colorB; }
+  if (record(rect)) return;
+  auto clip = getClipRect();
+  if (!SDL_IntersectRect(&rect, &clip, &rect)) return;
+  int bands = bandCount(parallel, rect, size_t(rect.w) * rect.h);
+  if (bands > 1) {
+    paintBands(surface, rect, bands, [&](auto view, SDL_Rect band) {
+      fillArea(view, brush, band, band);
+    });
+  } else if (!brush.pattern.data8x8 &&
+             brush.blendMode == BlendMode::REPLACE) {
+    surface.fillRect(rect, brush.colorA);
+  } else {
+    visitSurface(surface.get(),
+                 [&](auto view) { fillArea(view, brush, rect, rect); });
   }
-  surface.setPixel(p.x, p.y, color);
+  markDirty(rect);
 }
 
 void
-doPoint(Surface surface, const Brush& b, SDL_Point p)
-{
-  if (b.pen.type == Pen::BOX) {
-    int xBeg = p.x - (b.pen.w / 2 + b.pen.w % 2 - 1);
-    int xEnd = xBeg + b.pen.w;
-    int yBeg = p.y - (b.pen.h / 2 + b.pen.h % 2 - 1);
-    int yEnd = yBeg + b.pen.h;
-    for (int i = yBeg; i < yEnd; ++i) {
-      for (int j = xBeg; j < xEnd; ++j) { doPixel(surface, b, {j, i}); }
+Canvas::putStamps(SDL_Rect centers)
+{
+  const auto& pen = brush.pen;
+  const auto& stamp = *pen.stamp;
+  const int offsetX = pen.w / 2 + pen.w % 2 - 1;
+  const int offsetY = pen.h / 2 + pen.h % 2 - 1;
+  if (recording) {
+    for (int y = centers.y; y < centers.y + centers.h; ++y) {
+      for (int x = centers.x; x < centers.x + centers.w; ++x) {
+        SDL_Rect rect{x - offsetX, y - offsetY, pen.w, pen.h};
+        if (!clipping || SDL_HasIntersection(&rect, &clipRect)) {
+          recording->addStamp(stamp, brush.blendMode, rect);
+        }
+      }
     }
+    return;
+  }
+  auto area = penArea(pen, centers);
+  auto clip = getClipRect();
+  if (!SDL_IntersectRect(&area, &clip, &area)) return;
+  auto pixels = stamp.getPixels(surface.getFormat());
+  // Only the centers whose stamp reaches the visible area
+  const int x0 = std::max(centers.x, area.x + offsetX - pen.w + 1);
+  const int y0 = std::max(centers.y, area.y + offsetY - pen.h + 1);
+  const int x1 = std::min(centers.x + centers.w, area.x + area.w + offsetX);
+  const int y1 = std::min(centers.y + centers.h, area.y + area.h + offsetY);
+  visitSurface(surface.get(), [&](auto view) {
+    decltype(view) stampView{pixels.get()};
+    for (int y = y0; y < y1; ++y) {
+      for (int x = x0; x < x1; ++x) {
+        stampAt(view,
+                stampView,
+                stamp,
+                brush.blendMode,
+                x - offsetX,
+                y - offsetY,
+                area);
+      }
+    }
+  });
+  markDirty(area);
+}
+
+void
+Canvas::paint(const SDL_Rect& centers)
+{
+  if (brush.pen.type == Pen::STAMP) {
+    putStamps(centers);
   } else {
-    doPixel(surface, b, p);
+    fill(penArea(brush.pen, centers));
   }
 }
 
 Canvas&
 operator|(Canvas& c, SDL_Point p)
 {
-  doPoint(c.surface, c.brush, p);
+  c.paint({p.x, p.y, 1, 1});
   return c;
 }
 
-void
-doHLine(Surface surface, const Brush& b, const HorizontalLine& l)
+Canvas&
+operator|(Canvas& c, HorizontalLine l)
 {
-  SDL_Point p{l.x, l.y};
-  for (int i = 0; i < l.length; ++i, ++p.x) doPoint(surface, b, p);
+  if (l.length > 0) c.paint({l.x, l.y, l.length, 1});
+  return c;
 }
 
 Canvas&
-operator|(Canvas& c, HorizontalLine l)
+operator|(Canvas& c, HorizontalLines lines)
 {
-  if (c.brush.pattern.data8x8 || c.brush.pen.type != Pen::DOT) {
-    doHLine(c.surface, c.brush, l);
-  } else {
-    c.surface.fillRect({l.x, l.y, l.length, 1}, c.brush.colorA);
+  if (c.isRecording() || c.brush.pen.type == Pen::STAMP) {
+    for (auto& l : lines) c | l;
+    return c;
+  }
+  SDL_Rect area{0, 0, 0, 0};
+  size_t work = 0;
+  for (auto& l : lines) {
+    if (l.length <= 0) continue;
+    auto rect = penArea(c.brush.pen, {l.x, l.y, l.length, 1});
+    work += size_t(rect.w) * rect.h;
+    if (SDL_RectEmpty(&area)) {
+      area = rect;
+    } else {
+      SDL_UnionRect(&area, &rect, &area);
+    }
   }
+  auto clip = c.getClipRect();
+  if (!SDL_IntersectRect(&area, &clip, &area)) return c;
+  int bands = bandCount(c.parallel, area, work);
+  if (bands <= 1) {
+    for (auto& l : lines) c | l;
+    return c;
+  }
+  paintBands(c.surface, area, bands, [&](auto view, SDL_Rect band) {
+    for (auto& l : lines) {
+      if (l.length <= 0 || l.y < band.y - c.brush.pen.h ||
+          l.y >= band.y + band.h + c.brush.pen.h) {
+        continue;
+      }
+      fillArea(
+        view, c.brush, penArea(c.brush.pen, {l.x, l.y, l.length, 1}), band);
+    }
+  });
+  c.markDirty(area);
   return c;
 }
 
 Canvas&
-operator|(Canvas& c, LineTo l)
+operator|(Canvas& c, const PenStroke& stroke)
 {
-  rasterLine(l.x1, l.y1, l.x2, l.y2, [&](int x, int y) {
-    doPoint(c.surface, c.brush, {x, y});
+  if (c.brush.pen.type == Pen::STAMP) {
+    stroke.forEachCenter(
+      [&](int x, int y, int len) { c.paint({x, y, len, 1}); });
+    return c;
+  }
+  if (c.isRecording()) {
+    stroke.forEachSpan(
+      [&](int x, int y, int len) { c.record({x, y, len, 1}); });
+    return c;
+  }
+  int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+  auto clip = c.getClipRect();
+  visitSurface(c.surface.get(), [&](auto view) {
+    stroke.forEachSpan([&](int x, int y, int len) {
+      fillArea(view, c.brush, {x, y, len, 1}, clip);
+      x0 = std::min(x0, x);
+      y0 = std::min(y0, y);
+      x1 = std::max(x1, x + len);
+      y1 = std::max(y1, y + 1);
+    });
   });
+  if (x0 < x1) c.markDirty({x0, y0, x1 - x0, y1 - y0});
   return c;
 }
 
 Canvas&
-operator|(Canvas& c, OpenLineTo l)
+operator|(Canvas& c, LineTo l)
 {
-  rasterLineOpen(l.x1, l.y1, l.x2, l.y2, [&](int x, int y) {
-    doPoint(c.surface, c.brush, {x, y});
-  });
-  return c;
+  PenStroke stroke{c.brush.pen, c.getPenClipRect()};
+  stroke.addOpenLine(l.x1, l.y1, l.x2, l.y2);
+  stroke.add(l.x2, l.y2);
+  return c | stroke;
 }
 
-void
-doBox(Surface surface, const Brush& b, const SDL_Rect& rect)
+Canvas&
+operator|(Canvas& c, OpenLineTo l)
 {
-  if (b.pattern.data8x8 || b.pen.type != Pen::DOT) {
-    HorizontalLine l{rect.x, rect.y, rect.w};
-    for (int i = 0; i < rect.h; ++i, ++l.y) doHLine(surface, b, l);
-  } else {
-    surface.fillRect(rect, b.colorA);
-  }
+  PenStroke stroke{c.brush.pen, c.getPenClipRect()};
+  stroke.addOpenLine(l.x1, l.y1, l.x2, l.y2);
+  return c | stroke;
 }
 
 Canvas&
 operator|(Canvas& c, SDL_Rect rect)
 {
-  doBox(c.surface, c.brush, rect);
+  if (!SDL_RectEmpty(&rect)) c.paint(rect);
   return c;
 }
 
+/// @brief Blit to surface, not touching anything outside clip
+static void
+blitClipped(Surface surface,
+            const SDL_Rect& clip,
+            Surface source,
+            const SDL_Rect& rect,
+            bool scaled)
+{
+  if (!surface) return;
+  SDL_Rect old;
+  SDL_GetClipRect(surface.get(), &old);
+  SDL_SetClipRect(surface.get(), &clip);
+  if (scaled) {
+    surface.blitScaled(source, rect);
+  } else {
+    surface.blit(source, {rect.x, rect.y});
+  }
+  SDL_SetClipRect(surface.get(), &old);
+}
+
 Canvas&
 operator|(Canvas& c, Blit blit)
 {
-  c.surface.blit(blit.surface, blit.pos);
+  if (c.recording) {
+    SDL_Rect rect{
+      blit.pos.x, blit.pos.y, blit.surface.getW(), blit.surface.getH()};
+    c.recording->addBlit(blit.surface, rect, false);
+    return c;
+  }
+  SDL_Rect rect{
+    blit.pos.x, blit.pos.y, blit.surface.getW(), blit.surface.getH()};
+  blitClipped(c.surface, c.getClipRect(), blit.surface, rect, false);
+  c.markDirty(rect);
   return c;
 }
 Canvas&
 operator|(Canvas& c, BlitScaled blit)
 {
-  c.surface.blitScaled(blit.surface, blit.rect);
+  if (c.recording) {
+    c.recording->addBlit(blit.surface, blit.rect, true);
+    return c;
+  }
+  blitClipped(c.surface, c.getClipRect(), blit.surface, blit.rect, true);
+  c.markDirty(blit.rect);
+  return c;
+}
+
+Canvas&
+operator|(Canvas& c, const CanvasCommandList& list)
+{
+  // Colors are kept in the format of the recording surface
+  auto format = c.surface.getFormat();
+  std::vector<Brush> brushes;
+  for (auto& entry : list.getBrushes()) {
+    Brush b = entry.brush;
+    if (format != list.getFormat()) {
+      b.colorA = componentToRaw(entry.colorA, format);
+      b.colorB = componentToRaw(entry.colorB, format);
+    }
+    brushes.push_back(b);
+  }
+  if (c.recording) {
+    list.replay(
+      {INT_MIN / 2, INT_MIN / 2, INT_MAX, INT_MAX},
+      [&](auto& span) {
+        c.recording->addFill(
+          brushes[span.brush], format, {span.x, span.y, span.len, 1});
+      },
+      [&](Surface surface, const SDL_Rect& rect, bool scaled) {
+        c.recording->addBlit(surface, rect, scaled);
+      },
+      [&](const Stamp& stamp, BlendMode mode, const SDL_Rect& rect) {
+        c.recording->addStamp(stamp, mode, rect);
+      });
+    return c;
+  }
+  auto clip = c.getClipRect();
+  visitSurface(c.surface.get(), [&](auto view) {
+    list.replay(
+      clip,
+      [&](auto& span) {
+        fillArea(
+          view, brushes[span.brush], {span.x, span.y, span.len, 1}, clip);
+      },
+      [&](Surface surface, const SDL_Rect& rect, bool scaled) {
+        blitClipped(c.surface, clip, surface, rect, scaled);
+      },
+      [&](const Stamp& stamp, BlendMode mode, const SDL_Rect& rect) {
+        auto pixels = stamp.getPixels(format);
+        decltype(view) stampView{pixels.get()};
+        stampAt(view, stampView, stamp, mode, rect.x, rect.y, clip);
+      });
+  });
+  c.markDirty(list.getBounds());
   return c;
 }
 
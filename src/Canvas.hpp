@@ -3,6 +3,7 @@
 
 #include <array>
 #include <cstdlib>
+#include <span>
 #include <SDL.h>
 #include "Brush.hpp"
 #include "Surface.hpp"
@@ -14,11 +15,26 @@ namespace pixedit {
 struct HorizontalLine;
 struct LineTo;
 struct OpenLineTo;
+class PenStroke;
 struct Blit;
+class CanvasCommandList;
 struct BlitScaled;
 struct ColorB;
 struct RawColorB;
 
+/// @brief Many horizontal lines, painted as a single fill
+using HorizontalLines = std::span<const HorizontalLine>;
+
+/// @brief How large fills are split in horizontal bands painted in parallel
+struct ParallelFill
+{
+  unsigned threads; ///< @brief Bands per fill, 0 for one per core, 1 for off
+  size_t cutoff;    ///< @brief Fills covering fewer pixels are not split
+
+  /// @brief The settings from defaults.hpp
+  static ParallelFill fromDefaults();
+};
+
 /// @brief Sets color
 using RawColorA = RawColor;
 
@@ -29,6 +45,25 @@ class Canvas
 {
   Surface surface;
   Brush brush;
+  SDL_Rect dirtyRect{0, 0, 0, 0};
+  ParallelFill parallel = ParallelFill::fromDefaults();
+  CanvasCommandList* recording = nullptr;
+  SDL_Rect clipRect{0, 0, 0, 0};
+  bool clipping = false;
+
+  void markDirty(SDL_Rect rect);
+
+  /// @brief If recording, add a fill of rect to the list and return true
+  bool record(SDL_Rect rect);
+
+  /// @brief Paint or record rect, already covering the pen
+  void fill(SDL_Rect rect);
+
+  /// @brief Put the stamp of the pen centered at each point of centers
+  void putStamps(SDL_Rect centers);
+
+  /// @brief Paint or record the pen centered at each point of centers
+  void paint(const SDL_Rect& centers);
 
 public:
   Canvas(Surface surface = {})
@@ -54,20 +89,59 @@ public:
 
   constexpr const Brush& getBrush() const { return brush; }
 
+  /// @brief The bounding box of everything drawn since the last reset
+  constexpr const SDL_Rect& getDirtyRect() const { return dirtyRect; }
+
+  constexpr void resetDirtyRect() { dirtyRect = {0, 0, 0, 0}; }
+
+  /// @brief Only draw inside rect, besides the surface bounds
+  constexpr void setClipRect(const SDL_Rect& rect)
+  {
+    clipRect = rect;
+    clipping = true;
+  }
+
+  /// @brief Draw on the whole surface again
+  constexpr void resetClipRect() { clipping = false; }
+
+  /// @brief Where drawing may change pixels, the clip rect inside the surface
+  SDL_Rect getClipRect() const;
+
+  /// @brief Where the pen center must be for the pen to reach the clip rect
+  SDL_Rect getPenClipRect() const;
+
+  /// @brief Add what is drawn to list instead of painting it
+  constexpr void startRecording(CanvasCommandList& list) { recording = &list; }
+
+  constexpr void stopRecording() { recording = nullptr; }
+
+  constexpr bool isRecording() const { return recording != nullptr; }
+
+  constexpr const ParallelFill& getParallelFill() const { return parallel; }
+
+  constexpr void setParallelFill(const ParallelFill& value)
+  {
+    parallel = value;
+  }
+
   friend constexpr Canvas& operator|(Canvas& c, RawColor rawColor);
   friend constexpr Canvas& operator|(Canvas& c, RawColorB rawColor);
   friend Canvas& operator|(Canvas& c, Color color);
   friend Canvas& operator|(Canvas& c, ColorB color);
   friend constexpr Canvas& operator|(Canvas& c, Pattern pattern);
+  friend constexpr Canvas& operator|(Canvas& c, BlendMode mode);
   friend constexpr Canvas& operator|(Canvas& c, const Pen& pen);
   friend constexpr Canvas& operator|(Canvas& c, const Brush& brush);
   friend Canvas& operator|(Canvas& c, SDL_Point p);
   friend Canvas& operator|(Canvas& c, HorizontalLine l);
+  friend Canvas& operator|(Canvas& c, HorizontalLines lines);
   friend Canvas& operator|(Canvas& c, LineTo l);
   friend Canvas& operator|(Canvas& c, OpenLineTo l);
+  friend Canvas& operator|(Canvas& c, const PenStroke& stroke);
   friend Canvas& operator|(Canvas& c, SDL_Rect rect);
   friend Canvas& operator|(Canvas& c, Blit blit);
   friend Canvas& operator|(Canvas& c, BlitScaled blit);
+  friend Canvas& operator|(Canvas& c, const CanvasCommandList& list);
 };
 
 constexpr Canvas&
@@ -98,6 +172,14 @@ operator|(Canvas& c, Pattern pattern)
   return c;
 }
 
+/// @brief Set how the colors are put on the pixels
+constexpr Canvas&
+operator|(Canvas& c, BlendMode mode)
+{
+  c.brush.blendMode = mode;
+  return c;
+}
+
 constexpr Canvas&
 operator|(Canvas& c, const Pen& pen)
 {
@@ -0,0 +1,129 @@
+#include "CanvasCommandList.hpp"
+#include <algorithm>
+#include <climits>
+
+namespace pixedit {
+
+void
+CanvasCommandList::clear()
+{
+  brushes.clear();
+  fills.clear();
+  blits.clear();
+  format = nullptr;
+  bounds = {0, 0, 0, 0};
+}
+
+void
+CanvasCommandList::grow(const SDL_Rect& rect)
+{
+  if (SDL_RectEmpty(&bounds)) {
+    bounds = rect;
+  } else {
+    SDL_UnionRect(&bounds, &rect, &bounds);
+  }
+}
+
+void
+CanvasCommandList::addFill(const Brush& brush,
+                           const SDL_PixelFormat* format,
+                           const SDL_Rect& rect)
+{
+  if (SDL_RectEmpty(&rect)) return;
+  if (brushes.empty()) this->format = format;
+  Brush b = brush;
+  if (format != this->format) {
+    b.colorA =
+      componentToRaw(rawToComponent(b.colorA, format), this->format);
+    b.colorB =
+      componentToRaw(rawToComponent(b.colorB, format), this->format);
+  }
+  // The pen is already in the rect, only colors, pattern and blending matter
+  bool same = !brushes.empty() && brushes.back().brush.colorA == b.colorA &&
+              brushes.back().brush.colorB == b.colorB &&
+              brushes.back().brush.pattern.data8x8 == b.pattern.data8x8 &&
+              brushes.back().brush.blendMode == b.blendMode;
+  if (!same) {
+    brushes.push_back({
+      b,
+      rawToComponent(b.colorA, this->format),
+      rawToComponent(b.colorB, this->format),
+    });
+  }
+  fills.push_back({rect, Uint32(brushes.size() - 1)});
+  grow(rect);
+}
+
+void
+CanvasCommandList::addBlit(Surface surface, const SDL_Rect& rect, bool scaled)
+{
+  blits.push_back({fills.size(), surface, rect, scaled, nullptr, {}});
+  grow(rect);
+}
+
+void
+CanvasCommandList::addStamp(const Stamp& stamp,
+                            BlendMode mode,
+                            const SDL_Rect& rect)
+{
+  blits.push_back({fills.size(), nullptr, rect, false, &stamp, mode});
+  grow(rect);
+}
+
+void
+CanvasCommandList::rowSpans(size_t first,
+                            size_t last,
+                            const SDL_Rect& clip,
+                            std::vector<Span>& spans) const
+{
+  spans.clear();
+  int yMin = INT_MAX, yMax = INT_MIN;
+  size_t total = 0;
+  for (size_t i = first; i < last; ++i) {
+    SDL_Rect rect;
+    if (!SDL_IntersectRect(&fills[i].rect, &clip, &rect)) continue;
+    yMin = std::min(yMin, rect.y);
+    yMax = std::max(yMax, rect.y + rect.h);
+    total += rect.h;
+  }
+  if (total == 0) return;
+
+  // Bin by row, keeping the drawing order inside each one
+  std::vector<size_t> next(yMax - yMin + 1, 0);
+  for (size_t i = first; i < last; ++i) {
+    SDL_Rect rect;
+    if (!SDL_IntersectRect(&fills[i].rect, &clip, &rect)) continue;
+    for (int y = rect.y; y < rect.y + rect.h; ++y) ++next[y - yMin + 1];
+  }
+  for (size_t i = 1; i < next.size(); ++i) next[i] += next[i - 1];
+  spans.resize(total);
+  for (size_t i = first; i < last; ++i) {
+    SDL_Rect rect;
+    if (!SDL_IntersectRect(&fills[i].rect, &clip, &rect)) continue;
+    for (int y = rect.y; y < rect.y + rect.h; ++y) {
+      spans[next[y - yMin]++] = {rect.x, y, rect.w, fills[i].brush};
+    }
+  }
+
+  // Join neighbors in the same row and brush that continue one another. Only
+  // a brush replacing the pixels can also join overlapping ones, any other
+  // has to blend the overlap twice.
+  auto out = spans.begin();
+  for (auto it = spans.begin() + 1; it != spans.end(); ++it) {
+    if (it->y != out->y || it->brush != out->brush) {
+      *++out = *it;
+    } else if (it->x == out->x + out->len) {
+      out->len += it->len;
+    } else if (brushes[out->brush].brush.blendMode == BlendMode::REPLACE &&
+               it->x <= out->x + out->len && it->x + it->len >= out->x) {
+      int x1 = std::max(out->x + out->len, it->x + it->len);
+      out->x = std::min(out->x, it->x);
+      out->len = x1 - out->x;
+    } else {
+      *++out = *it;
+    }
+  }
+  spans.erase(out + 1, spans.end());
+}
+
+} // namespace pixedit
@@ -0,0 +1,144 @@
+#ifndef PIXEDIT_SRC_CANVAS_COMMAND_LIST_INCLUDED
+#define PIXEDIT_SRC_CANVAS_COMMAND_LIST_INCLUDED
+
+#include <concepts>
+#include <vector>
+#include <SDL.h>
+#include "Brush.hpp"
+#include "Surface.hpp"
+
+namespace pixedit {
+
+class Stamp;
+
+/**
+ * Drawing recorded from a Canvas, to paint later in a single pass
+ *
+ * Call Canvas::startRecording(), draw on the canvas as usual and call
+ * Canvas::stopRecording(). Every primitive is kept as the pen covered rects
+ * it would fill, with its brush, and `canvas | list` paints them on any
+ * canvas, as many times as needed.
+ *
+ * The fills are painted row by row, top to bottom, instead of one primitive
+ * after the other. Inside a row they keep the order they were drawn in, and
+ * consecutive ones with the same brush where one starts right at the end of
+ * the other are merged in one span. Those overlapping are merged too when the
+ * brush replaces the pixels, as painting them twice changes nothing then.
+ * Blits and stamps can not be reordered, so the fills before each of them
+ * are painted before it.
+ */
+class CanvasCommandList
+{
+public:
+  /// @brief A run of a single row to paint with brushes[brush]
+  struct Span
+  {
+    int x;
+    int y;
+    int len;
+    Uint32 brush;
+  };
+
+  /// @brief A brush, with its colors also as components to change formats
+  struct BrushEntry
+  {
+    Brush brush;
+    Color colorA;
+    Color colorB;
+  };
+
+private:
+  struct Fill
+  {
+    SDL_Rect rect;
+    Uint32 brush;
+  };
+
+  struct BlitEntry
+  {
+    size_t fillsBefore;
+    Surface surface;
+    SDL_Rect rect;
+    bool scaled;
+    const Stamp* stamp; ///< If set, put this instead of blitting surface
+    BlendMode mode;
+  };
+
+  std::vector<BrushEntry> brushes;
+  std::vector<Fill> fills;
+  std::vector<BlitEntry> blits;
+  const SDL_PixelFormat* format = nullptr;
+  SDL_Rect bounds{0, 0, 0, 0};
+
+public:
+  bool empty() const { return fills.empty() && blits.empty(); }
+
+  void clear();
+
+  /// @brief The bounding box of everything recorded
+  constexpr const SDL_Rect& getBounds() const { return bounds; }
+
+  /// @brief The format the brush colors were recorded in
+  constexpr const SDL_PixelFormat* getFormat() const { return format; }
+
+  const std::vector<BrushEntry>& getBrushes() const { return brushes; }
+
+  /// @brief Record filling rect with the colors and pattern of brush
+  void addFill(const Brush& brush,
+               const SDL_PixelFormat* format,
+               const SDL_Rect& rect);
+
+  /// @brief Record a blit of surface at rect, resized if scaled
+  void addBlit(Surface surface, const SDL_Rect& rect, bool scaled);
+
+  /**
+   * Record putting stamp with mode, with its top left corner at rect
+   *
+   * The stamp is kept by reference, as by Pen, so it must outlive the list.
+   */
+  void addStamp(const Stamp& stamp, BlendMode mode, const SDL_Rect& rect);
+
+  /**
+   * Call fillSpan(span) for each span, blit(surface, rect, scaled) for each
+   * blit and putStamp(stamp, mode, rect) for each stamp, in the order
+   * described above
+   *
+   * @param clip only the parts of spans inside this are given
+   */
+  template<std::invocable<const Span&> FILL_SPAN,
+           std::invocable<Surface, const SDL_Rect&, bool> BLIT,
+           std::invocable<const Stamp&, BlendMode, const SDL_Rect&> STAMP>
+  void replay(const SDL_Rect& clip,
+              FILL_SPAN fillSpan,
+              BLIT blit,
+              STAMP putStamp) const
+  {
+    std::vector<Span> spans;
+    size_t first = 0;
+    for (auto& b : blits) {
+      rowSpans(first, b.fillsBefore, clip, spans);
+      for (auto& span : spans) fillSpan(span);
+      if (b.stamp) {
+        putStamp(*b.stamp, b.mode, b.rect);
+      } else {
+        blit(b.surface, b.rect, b.scaled);
+      }
+      first = b.fillsBefore;
+    }
+    rowSpans(first, fills.size(), clip, spans);
+    for (auto& span : spans) fillSpan(span);
+  }
+
+private:
+  /// @brief The fills [first, last) inside clip, as merged spans by row
+  void rowSpans(size_t first,
+                size_t last,
+                const SDL_Rect& clip,
+                std::vector<Span>& spans) const;
+
+  void grow(const SDL_Rect& rect);
+};
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_CANVAS_COMMAND_LIST_INCLUDED */
@@ -0,0 +1,168 @@
+#include "CommandLog.hpp"
+#include <memory>
+#include <sstream>
+#include "PictureView.hpp"
+#include "utils/replayPicture.hpp"
+
+namespace pixedit {
+
+namespace defaults {
+extern const size_t COMMAND_LOG_KEYFRAME_INTERVAL;
+} // namespace defaults
+
+CommandLog::CommandLog()
+  : CommandLog(defaults::COMMAND_LOG_KEYFRAME_INTERVAL)
+{
+}
+
+CommandLog::CommandLog(size_t keyframeInterval)
+  : keyframeInterval(keyframeInterval)
+{
+}
+
+void
+CommandLog::reset(Surface surface)
+{
+  steps.clear();
+  steps.push_back({nextId++, {}, surface.clone()});
+  current = 0;
+  discard();
+  replayable = true;
+}
+
+void
+CommandLog::record(const PictureView& view)
+{
+  if (recording.empty()) recorded.reset();
+  auto& brush = view.canvas.getBrush();
+  // Stamps can not be written in the script, so keep the picture instead
+  if (brush.pen.type == Pen::STAMP) markUnreplayable();
+  auto& state = view.getState();
+  RecordedInput input{
+    IdOwn(view.getToolId()),
+    brush,
+    view.effectivePos(),
+    state.left,
+    state.right,
+    view.fillTolerance,
+    view.fillContiguous,
+  };
+  std::ostringstream out;
+  if (!recorded || recorded->toolId != input.toolId) {
+    out << "TOOL " << input.toolId << '\n';
+  }
+  out << std::hex;
+  if (!recorded || recorded->brush.colorA != brush.colorA) {
+    out << "COLOR " << brush.colorA << '\n';
+  }
+  if (!recorded || recorded->brush.colorB != brush.colorB) {
+    out << "COLOR_B " << brush.colorB << '\n';
+  }
+  if (!recorded ||
+      recorded->brush.pattern.data8x8 != brush.pattern.data8x8) {
+    out << "PATTERN " << brush.pattern.data8x8 << '\n';
+  }
+  out << std::dec;
+  if (!recorded || recorded->brush.blendMode != brush.blendMode) {
+    static const char* names[] = {"REPLACE", "OVER", "MULTIPLY", "ADD"};
+    out << "BLEND " << names[int(brush.blendMode)] << '\n';
+  }
+  if (!recorded || recorded->brush.pen.w != brush.pen.w ||
+      recorded->brush.pen.h != brush.pen.h) {
+    out << "PEN " << brush.pen.w << ' ' << brush.pen.h << '\n';
+  }
+  if (!recorded || recorded->fillTolerance != input.fillTolerance ||
+      recorded->fillContiguous != input.fillContiguous) {
+    out << "FILL " << input.fillTolerance << ' '
+        << (input.fillContiguous ? "CONTIGUOUS" : "GLOBAL") << '\n';
+  }
+  if (!recorded || recorded->pos.x != input.pos.x ||
+      recorded->pos.y != input.pos.y) {
+    out << "POS " << input.pos.x << ' ' << input.pos.y << '\n';
+  }
+  if (!recorded || recorded->left != input.left) {
+    out << "LEFT " << (input.left ? "DOWN" : "UP") << '\n';
+  }
+  if (!recorded || recorded->right != input.right) {
+    out << "RIGHT " << (input.right ? "DOWN" : "UP") << '\n';
+  }
+  auto lines = out.str();
+  if (lines.empty()) return;
+  recording += lines;
+  recording += "FRAME\n";
+  recorded = std::move(input);
+}
+
+void
+CommandLog::discard()
+{
+  recording.clear();
+  recorded.reset();
+}
+
+void
+CommandLog::commit(const Surface& surface)
+{
+  if (steps.empty()) return;
+  size_t sinceKeyframe = 0;
+  for (size_t i = current; !steps[i].keyframe; --i) ++sinceKeyframe;
+
+  steps.erase(steps.begin() + current + 1, steps.end());
+  auto& step = steps.emplace_back(Step{nextId++});
+  if (!replayable || recording.empty() || sinceKeyframe >= keyframeInterval) {
+    step.keyframe = surface.clone();
+  } else {
+    step.script = std::move(recording);
+  }
+  current = steps.size() - 1;
+  discard();
+  replayable = true;
+}
+
+Surface
+CommandLog::undo()
+{
+  if (!canUndo()) return nullptr;
+  return rebuild(--current);
+}
+
+Surface
+CommandLog::redo()
+{
+  if (!canRedo()) return nullptr;
+  return rebuild(++current);
+}
+
+size_t
+CommandLog::getBytes() const
+{
+  size_t bytes = 0;
+  for (auto& step : steps) {
+    bytes += sizeof(Step) + step.script.size();
+    if (step.keyframe) {
+      bytes += step.keyframe.getH() * step.keyframe.get()->pitch;
+    }
+  }
+  return bytes;
+}
+
+Surface
+CommandLog::rebuild(size_t index) const
+{
+  size_t keyframe = index;
+  while (!steps[keyframe].keyframe) --keyframe;
+  auto surface = steps[keyframe].keyframe.clone();
+  if (keyframe == index) return surface;
+
+  // With the viewport the size of the picture, positions map 1:1
+  PictureView view{{0, 0, surface.getW(), surface.getH()}};
+  view.setBuffer(std::make_shared<PictureBuffer>("", surface));
+  view.update(nullptr);
+  for (size_t i = keyframe + 1; i <= index; ++i) {
+    std::istringstream in{steps[i].script};
+    replayPicture(in, view);
+  }
+  return view.getBuffer()->getSurface();
+}
+
+} // namespace pixedit
@@ -0,0 +1,112 @@
+#ifndef PIXEDIT_SRC_COMMAND_LOG_INCLUDED
+#define PIXEDIT_SRC_COMMAND_LOG_INCLUDED
+
+#include <optional>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include "Brush.hpp"
+#include "Id.hpp"
+#include "Surface.hpp"
+
+namespace pixedit {
+
+// Forward decl
+class PictureView;
+
+/**
+ * An undo history storing each step as the input that produced it
+ *
+ * Steps are scripts in the replayPicture() language, recorded from the view
+ * frame by frame while a tool edits. Every few steps, and whenever a step
+ * can not be reproduced by its input (pasting, moving a selection, reloading),
+ * a full keyframe is kept instead. Going to a step restores the nearest
+ * keyframe before it and replays the scripts after it.
+ *
+ * A stroke costs a few hundred bytes instead of the pixels it changed, in
+ * exchange undo and redo get slower the farther the last keyframe is.
+ */
+class CommandLog
+{
+public:
+  /// @brief An identifier for a state, unique within this log
+  using StateId = Uint64;
+
+private:
+  struct Step
+  {
+    StateId id;
+    std::string script;
+    Surface keyframe;
+  };
+
+  struct RecordedInput
+  {
+    IdOwn toolId;
+    Brush brush;
+    SDL_Point pos;
+    bool left;
+    bool right;
+    int fillTolerance;
+    bool fillContiguous;
+  };
+
+  std::vector<Step> steps;
+  size_t current = 0;
+  StateId nextId = 1;
+  size_t keyframeInterval;
+  std::string recording;
+  std::optional<RecordedInput> recorded;
+  bool replayable = true;
+
+public:
+  CommandLog();
+
+  CommandLog(size_t keyframeInterval);
+
+  /// @brief Discard all steps and start from the given state
+  void reset(Surface surface);
+
+  /// @brief Append what changed on the view input since the last frame
+  void record(const PictureView& view);
+
+  /// @brief Drop the input recorded since the last commit
+  void discard();
+
+  /// @brief The surface changed in a way its input can not reproduce
+  void markUnreplayable() { replayable = false; }
+
+  /**
+   * Turn the recorded input into a step
+   *
+   * Any step after the current one is discarded.
+   * @param surface the state after the step, kept if it becomes a keyframe.
+   */
+  void commit(const Surface& surface);
+
+  bool canUndo() const { return current > 0; }
+
+  bool canRedo() const { return current + 1 < steps.size(); }
+
+  /// @brief Go back a step and return its state
+  Surface undo();
+
+  /// @brief Go forward a step and return its state
+  Surface redo();
+
+  /// @brief The id of the state on the current step
+  StateId getStateId() const { return steps.empty() ? 0 : steps[current].id; }
+
+  /// @brief The number of steps after the initial state
+  size_t size() const { return steps.empty() ? 0 : steps.size() - 1; }
+
+  /// @brief Bytes used by scripts and keyframes
+  size_t getBytes() const;
+
+private:
+  Surface rebuild(size_t index) const;
+};
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_COMMAND_LOG_INCLUDED */
@@ -0,0 +1,733 @@
+#include "History.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <concepts>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include "utils/TempSurface.hpp"
+#include "utils/pixelRle.hpp"
+
+namespace pixedit {
+
+namespace defaults {
+extern const size_t HISTORY_MEMORY_BUDGET;
+extern const size_t HISTORY_DISK_BUDGET;
+} // namespace defaults
+
+namespace {
+
+/// @brief Tiles are addressed in bytes, so any pixel size works
+struct TileGrid
+{
+  int bitsPerPixel;
+  int unitSz;
+  int w;
+  int rowSz;
+  int h;
+  int tileSz;
+  int cols;
+  int rows;
+
+  TileGrid(const SDL_Surface* surface)
+    : bitsPerPixel(surface->format->BitsPerPixel)
+    , unitSz(std::max<int>(1, surface->format->BytesPerPixel))
+    , w(surface->w)
+    , rowSz((surface->w * bitsPerPixel + 7) / 8)
+    , h(surface->h)
+    , tileSz(History::TILE_SIZE * unitSz)
+    , cols((rowSz + tileSz - 1) / tileSz)
+    , rows((h + History::TILE_SIZE - 1) / History::TILE_SIZE)
+  {
+  }
+
+  constexpr Uint32 count() const { return cols * rows; }
+
+  /// @brief The tile bounds, with x and w in bytes
+  constexpr SDL_Rect bounds(Uint32 index) const
+  {
+    int x = (index % cols) * tileSz;
+    int y = (index / cols) * History::TILE_SIZE;
+    return {
+      x,
+      y,
+      std::min(tileSz, rowSz - x),
+      std::min(History::TILE_SIZE, h - y),
+    };
+  }
+
+  /// @brief The tile bounds in pixels
+  constexpr SDL_Rect pixelBounds(Uint32 index) const
+  {
+    auto b = bounds(index);
+    int x0 = b.x * 8 / bitsPerPixel;
+    int x1 = std::min(w, ((b.x + b.w) * 8 + bitsPerPixel - 1) / bitsPerPixel);
+    return {x0, b.y, x1 - x0, b.h};
+  }
+
+  /// @brief Call callback with the index of each tile overlapping region
+  template<std::invocable<Uint32> CALLBACK>
+  void forEachIn(const SDL_Rect& region, CALLBACK callback) const
+  {
+    if (region.w <= 0 || region.h <= 0) return;
+    int col0 = region.x * bitsPerPixel / 8 / tileSz;
+    int col1 = ((region.x + region.w) * bitsPerPixel + 7) / 8;
+    col1 = std::min(cols - 1, (col1 - 1) / tileSz);
+    int row0 = region.y / History::TILE_SIZE;
+    int row1 = (region.y + region.h - 1) / History::TILE_SIZE;
+    row1 = std::min(rows - 1, row1);
+    for (int row = row0; row <= row1; ++row) {
+      for (int col = col0; col <= col1; ++col) { callback(row * cols + col); }
+    }
+  }
+};
+
+bool
+sameGeometry(const Surface& lhs, const Surface& rhs)
+{
+  return lhs.getW() == rhs.getW() && lhs.getH() == rhs.getH() &&
+         lhs.getFormat()->format == rhs.getFormat()->format;
+}
+
+Uint8*
+rowAt(const Surface& surface, const SDL_Rect& bounds, int i)
+{
+  auto s = surface.get();
+  auto pixels = static_cast<Uint8*>(s->pixels);
+  return pixels + (bounds.y + i) * s->pitch + bounds.x;
+}
+
+bool
+tileEquals(const Surface& lhs, const Surface& rhs, const SDL_Rect& bounds)
+{
+  for (int i = 0; i < bounds.h; ++i) {
+    if (memcmp(rowAt(lhs, bounds, i), rowAt(rhs, bounds, i), bounds.w)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+copyTile(const Surface& dst, const Surface& src, const SDL_Rect& bounds)
+{
+  for (int i = 0; i < bounds.h; ++i) {
+    memcpy(rowAt(dst, bounds, i), rowAt(src, bounds, i), bounds.w);
+  }
+}
+
+/// @brief Create an empty file for spilling and return its name, or ""
+std::string
+makeSpillFile()
+{
+  // Shared by the workers of every open picture
+  static std::atomic<unsigned> count = 0;
+  for (int attempt = 0; attempt < 64; ++attempt) {
+    auto filename =
+      makeTempFilename("history_" + std::to_string(count++) + "_", ".bin");
+    // Fails if it exists, so the name is ours even among other processes
+    if (FILE* file = std::fopen(filename.c_str(), "wbx")) {
+      std::fclose(file);
+      return filename;
+    }
+    if (errno != EEXIST) break;
+  }
+  return {};
+}
+
+} // namespace
+
+History::Entry::Entry(Entry&& rhs)
+  : id(rhs.id)
+  , tiles(std::move(rhs.tiles))
+  , replaced(std::move(rhs.replaced))
+  , bytes(rhs.bytes)
+  , spillFilename(std::move(rhs.spillFilename))
+  , pending(rhs.pending)
+  , unitSz(rhs.unitSz)
+{
+  rhs.spillFilename.clear();
+}
+
+History::Entry&
+History::Entry::operator=(Entry&& rhs)
+{
+  std::swap(id, rhs.id);
+  std::swap(tiles, rhs.tiles);
+  std::swap(replaced, rhs.replaced);
+  std::swap(bytes, rhs.bytes);
+  std::swap(spillFilename, rhs.spillFilename);
+  std::swap(pending, rhs.pending);
+  std::swap(unitSz, rhs.unitSz);
+  return *this;
+}
+
+History::Entry::~Entry()
+{
+  if (spillFilename.empty()) return;
+  std::error_code ec;
+  std::filesystem::remove(spillFilename, ec);
+}
+
+History::History()
+  : History(defaults::HISTORY_MEMORY_BUDGET, defaults::HISTORY_DISK_BUDGET)
+{
+}
+
+History::History(size_t memoryBudget, size_t diskBudget)
+  : memoryBudget(memoryBudget)
+  , diskBudget(diskBudget)
+{
+}
+
+History::~History()
+{
+  {
+    std::lock_guard lock{mutex};
+    stopping = true;
+  }
+  cv.notify_all();
+  if (worker.joinable()) worker.join();
+}
+
+void
+History::reset(Surface surface)
+{
+  auto lock = waitIdle();
+  entries.clear();
+  current = 0;
+  touched = {0, 0, 0, 0};
+  baseId = nextId++;
+  reference = surface.clone();
+  referenceBytes = reference ? reference.getH() * reference.get()->pitch : 0;
+  updateStats();
+}
+
+void
+History::rebase(const Surface& surface)
+{
+  auto lock = waitIdle();
+  entries.clear();
+  current = 0;
+  if (!reference || !surface || !sameGeometry(surface, reference)) {
+    reference = surface.clone();
+  } else {
+    TileGrid grid{reference.get()};
+    grid.forEachIn(touched, [&](Uint32 index) {
+      copyTile(reference, surface, grid.bounds(index));
+    });
+  }
+  touched = {0, 0, 0, 0};
+  baseId = nextId++;
+  referenceBytes = reference ? reference.getH() * reference.get()->pitch : 0;
+  updateStats();
+}
+
+void
+History::touch(const SDL_Rect& rect)
+{
+  if (!reference) return;
+  SDL_Rect bounds{0, 0, reference.getW(), reference.getH()};
+  SDL_Rect clipped;
+  if (!SDL_IntersectRect(&rect, &bounds, &clipped)) return;
+  if (SDL_RectEmpty(&touched)) {
+    touched = clipped;
+  } else {
+    SDL_UnionRect(&touched, &clipped, &touched);
+  }
+}
+
+void
+History::touchAll()
+{
+  touch({0, 0, reference.getW(), reference.getH()});
+}
+
+bool
+History::commit(const Surface& surface)
+{
+  if (!surface || !reference) return false;
+  Entry entry{nextId};
+  entry.pending = true;
+  if (!sameGeometry(surface, reference)) {
+    entry.replaced = reference;
+    entry.bytes = referenceBytes;
+    reference = surface.clone();
+  } else {
+    TileGrid grid{reference.get()};
+    entry.unitSz = grid.unitSz;
+    grid.forEachIn(touched, [&](Uint32 index) {
+      auto bounds = grid.bounds(index);
+      if (tileEquals(surface, reference, bounds)) return;
+      auto& delta = entry.tiles.emplace_back(TileDelta{index});
+      delta.data.resize(bounds.w * bounds.h);
+      auto it = delta.data.begin();
+      for (int i = 0; i < bounds.h; ++i) {
+        it = std::transform(rowAt(surface, bounds, i),
+                            rowAt(surface, bounds, i) + bounds.w,
+                            rowAt(reference, bounds, i),
+                            it,
+                            std::bit_xor<Uint8>{});
+      }
+      copyTile(reference, surface, bounds);
+      entry.bytes += sizeof(TileDelta) + delta.data.size();
+    });
+    touched = {0, 0, 0, 0};
+    if (entry.tiles.empty()) return false;
+  }
+  {
+    std::lock_guard lock{mutex};
+    entries.erase(entries.begin() + current, entries.end());
+    entries.push_back(std::move(entry));
+    ++nextId;
+    current = entries.size();
+    referenceBytes = reference.getH() * reference.get()->pitch;
+    ++pendingCount;
+  }
+  cv.notify_all();
+  if (!worker.joinable()) { worker = std::thread{&History::work, this}; }
+  return true;
+}
+
+SDL_Rect
+History::restore(Surface& surface)
+{
+  SDL_Rect restored{0, 0, 0, 0};
+  if (!reference) return restored;
+  if (!surface || !sameGeometry(surface, reference)) {
+    surface = reference.clone();
+    restored = {0, 0, surface.getW(), surface.getH()};
+  } else {
+    TileGrid grid{reference.get()};
+    grid.forEachIn(touched, [&](Uint32 index) {
+      auto bounds = grid.bounds(index);
+      if (!tileEquals(surface, reference, bounds)) {
+        copyTile(surface, reference, bounds);
+        auto pixelBounds = grid.pixelBounds(index);
+        SDL_UnionRect(&restored, &pixelBounds, &restored);
+      }
+    });
+  }
+  touched = {0, 0, 0, 0};
+  return restored;
+}
+
+std::optional<SDL_Rect>
+History::undo(Surface& surface)
+{
+  auto lock = waitIdle();
+  if (current == 0) return std::nullopt;
+  auto changed = restore(surface);
+  auto applied = apply(entries[--current], surface);
+  SDL_UnionRect(&changed, &applied, &changed);
+  return changed;
+}
+
+std::optional<SDL_Rect>
+History::redo(Surface& surface)
+{
+  auto lock = waitIdle();
+  if (current >= entries.size()) return std::nullopt;
+  auto changed = restore(surface);
+  auto applied = apply(entries[current++], surface);
+  SDL_UnionRect(&changed, &applied, &changed);
+  return changed;
+}
+
+bool
+History::canUndo() const
+{
+  std::lock_guard lock{mutex};
+  return current > 0;
+}
+
+bool
+History::canRedo() const
+{
+  std::lock_guard lock{mutex};
+  return current < entries.size();
+}
+
+History::StateId
+History::getStateId() const
+{
+  std::lock_guard lock{mutex};
+  return current == 0 ? baseId : entries[current - 1].id;
+}
+
+size_t
+History::size() const
+{
+  std::lock_guard lock{mutex};
+  return entries.size();
+}
+
+History::StateId
+History::getBaseId() const
+{
+  std::lock_guard lock{mutex};
+  return baseId;
+}
+
+History::StateId
+History::getStepId(size_t index) const
+{
+  std::lock_guard lock{mutex};
+  return entries.at(index).id;
+}
+
+size_t
+History::getPosition() const
+{
+  std::lock_guard lock{mutex};
+  return current;
+}
+
+Surface
+History::getStateAt(size_t position)
+{
+  auto lock = waitIdle();
+  if (!reference || position > entries.size()) return nullptr;
+  size_t first = std::min(position, current);
+  size_t last = std::max(position, current);
+  for (size_t i = first; i < last; ++i) {
+    if (entries[i].replaced) return nullptr;
+  }
+  auto surface = reference.clone();
+  std::vector<TileDelta> buffer;
+  for (size_t i = first; i < last; ++i) {
+    xorTiles(surface, tilesOf(entries[i], buffer));
+  }
+  return surface;
+}
+
+bool
+History::changesGeometry(size_t index) const
+{
+  std::lock_guard lock{mutex};
+  return bool(entries.at(index).replaced);
+}
+
+bool
+History::writeStep(size_t index, SDL_RWops* rw)
+{
+  auto lock = waitIdle();
+  auto& entry = entries.at(index);
+  if (entry.replaced) return false;
+  std::vector<TileDelta> buffer;
+  return writeTiles(rw, tilesOf(entry, buffer));
+}
+
+bool
+History::appendStep(SDL_RWops* rw, Sint64 size)
+{
+  auto lock = waitIdle();
+  if (!reference) return false;
+  Entry entry{nextId};
+  if (!readTiles(rw, size, entry.tiles)) return false;
+  TileGrid grid{reference.get()};
+  entry.unitSz = grid.unitSz;
+  std::vector<Uint8> diff;
+  for (auto& delta : entry.tiles) {
+    if (delta.index >= grid.count()) return false;
+    auto bounds = grid.bounds(delta.index);
+    diff.resize(bounds.w * bounds.h);
+    if (delta.sameAs < 0 && !decodeRle(delta.data, grid.unitSz, diff)) {
+      return false;
+    }
+    entry.bytes += sizeof(TileDelta) + delta.data.size();
+  }
+  ++nextId;
+  entries.push_back(std::move(entry));
+  enforceBudgets();
+  return true;
+}
+
+void
+History::flush()
+{
+  waitIdle();
+}
+
+HistoryStats
+History::getStats() const
+{
+  std::lock_guard lock{mutex};
+  return stats;
+}
+
+std::unique_lock<std::mutex>
+History::waitIdle()
+{
+  std::unique_lock lock{mutex};
+  cv.wait(lock, [&] { return pendingCount == 0; });
+  return lock;
+}
+
+void
+History::work()
+{
+  std::unique_lock lock{mutex};
+  for (;;) {
+    cv.wait(lock, [&] { return stopping || pendingCount > 0; });
+    if (stopping) return;
+    // Pending entries are only appended and never touched by the other side
+    // until idle, so it is safe to encode without the lock
+    auto& entry = *std::ranges::find_if(entries, &Entry::pending);
+    lock.unlock();
+    size_t bytes = 0;
+    std::unordered_multimap<size_t, int> seen;
+    for (int i = 0; i < int(entry.tiles.size()); ++i) {
+      auto& delta = entry.tiles[i];
+      std::vector<Uint8> packed;
+      encodeRle(delta.data, entry.unitSz, packed);
+      bytes += sizeof(TileDelta);
+      auto hash = std::hash<std::string_view>{}(
+        {reinterpret_cast<const char*>(packed.data()), packed.size()});
+      auto [first, last] = seen.equal_range(hash);
+      auto same = std::find_if(first, last, [&](auto& kv) {
+        return entry.tiles[kv.second].data == packed;
+      });
+      if (same != last) {
+        delta.sameAs = same->second;
+        std::vector<Uint8>{}.swap(delta.data);
+        continue;
+      }
+      seen.emplace(hash, i);
+      delta.data = std::move(packed);
+      bytes += delta.data.size();
+    }
+    lock.lock();
+    if (!entry.replaced) entry.bytes = bytes;
+    entry.pending = false;
+    --pendingCount;
+    enforceBudgets();
+    cv.notify_all();
+  }
+}
+
+SDL_Rect
+History::apply(Entry& entry, Surface& surface)
+{
+  if (entry.isSpilled()) unspill(entry);
+  if (entry.replaced) {
+    std::swap(reference, entry.replaced);
+    surface = reference.clone();
+    std::swap(referenceBytes, entry.bytes);
+    updateStats();
+    return {0, 0, surface.getW(), surface.getH()};
+  }
+  xorTiles(reference, entry.tiles);
+  TileGrid grid{reference.get()};
+  SDL_Rect applied{0, 0, 0, 0};
+  for (auto& delta : entry.tiles) {
+    copyTile(surface, reference, grid.bounds(delta.index));
+    auto pixelBounds = grid.pixelBounds(delta.index);
+    SDL_UnionRect(&applied, &pixelBounds, &applied);
+  }
+  enforceBudgets();
+  return applied;
+}
+
+void
+History::xorTiles(Surface& surface, const std::vector<TileDelta>& tiles) const
+{
+  TileGrid grid{reference.get()};
+  std::vector<Uint8> diff;
+  for (auto& delta : tiles) {
+    auto bounds = grid.bounds(delta.index);
+    diff.resize(bounds.w * bounds.h);
+    auto& data = delta.sameAs < 0 ? delta.data : tiles[delta.sameAs].data;
+    if (!decodeRle(data, grid.unitSz, diff)) {
+      throw std::runtime_error{"Can not recover"};
+    }
+    auto it = diff.begin();
+    for (int i = 0; i < bounds.h; ++i, it += bounds.w) {
+      auto row = rowAt(surface, bounds, i);
+      std::transform(row, row + bounds.w, it, row, std::bit_xor<Uint8>{});
+    }
+  }
+}
+
+const std::vector<History::TileDelta>&
+History::tilesOf(const Entry& entry, std::vector<TileDelta>& buffer) const
+{
+  if (!entry.isSpilled()) return entry.tiles;
+  SDL_RWops* rw = SDL_RWFromFile(entry.spillFilename.c_str(), "rb");
+  if (!rw) { throw std::runtime_error{"Can not recover"}; }
+  bool ok = readTiles(rw, SDL_RWsize(rw), buffer);
+  SDL_RWclose(rw);
+  if (!ok) { throw std::runtime_error{"Can not recover"}; }
+  return buffer;
+}
+
+void
+History::setMemoryBudget(size_t value)
+{
+  auto lock = waitIdle();
+  memoryBudget = value;
+  enforceBudgets();
+}
+
+void
+History::setDiskBudget(size_t value)
+{
+  auto lock = waitIdle();
+  diskBudget = value;
+  enforceBudgets();
+}
+
+void
+History::enforceBudgets()
+{
+  auto distance = [&](size_t i) {
+    return i < current ? current - 1 - i : i - current;
+  };
+  auto spillable = [&](size_t i) {
+    auto& entry = entries[i];
+    return !entry.isSpilled() && !entry.replaced && !entry.pending;
+  };
+  size_t inRam = 0, onDisk = 0;
+  for (auto& entry : entries) {
+    (entry.isSpilled() ? onDisk : inRam) += entry.bytes;
+  }
+  while (inRam > memoryBudget) {
+    size_t front = 0, back = entries.size();
+    while (front < back && !spillable(front)) ++front;
+    while (back > front && !spillable(back - 1)) --back;
+    if (front == back) break;
+    auto& entry =
+      entries[distance(front) >= distance(back - 1) ? front : back - 1];
+    if (!spill(entry)) break;
+    inRam -= entry.bytes;
+    onDisk += entry.bytes;
+  }
+  while (onDisk > diskBudget) {
+    if (current > 0 && entries.front().isSpilled()) {
+      onDisk -= entries.front().bytes;
+      dropFront();
+    } else if (current < entries.size() && entries.back().isSpilled()) {
+      onDisk -= entries.back().bytes;
+      dropBack();
+    } else {
+      break;
+    }
+  }
+  updateStats();
+}
+
+bool
+History::spill(Entry& entry)
+{
+  auto filename = makeSpillFile();
+  if (filename.empty()) return false;
+  SDL_RWops* rw = SDL_RWFromFile(filename.c_str(), "wb");
+  bool ok = rw && writeTiles(rw, entry.tiles);
+  if (rw) SDL_RWclose(rw);
+  std::error_code ec;
+  if (!ok) {
+    std::filesystem::remove(filename, ec);
+    return false;
+  }
+  entry.spillFilename = std::move(filename);
+  std::vector<TileDelta>{}.swap(entry.tiles);
+  return true;
+}
+
+void
+History::unspill(Entry& entry)
+{
+  auto start = SDL_GetPerformanceCounter();
+  SDL_RWops* rw = SDL_RWFromFile(entry.spillFilename.c_str(), "rb");
+  if (!rw) { throw std::runtime_error{"Can not recover"}; }
+  bool ok = readTiles(rw, SDL_RWsize(rw), entry.tiles);
+  SDL_RWclose(rw);
+  if (!ok) { throw std::runtime_error{"Can not recover"}; }
+  std::error_code ec;
+  std::filesystem::remove(entry.spillFilename, ec);
+  entry.spillFilename.clear();
+
+  auto elapsed = SDL_GetPerformanceCounter() - start;
+  stats.lastHitMs = elapsed * 1000.0 / SDL_GetPerformanceFrequency();
+  stats.totalHitMs += stats.lastHitMs;
+  stats.diskHits++;
+}
+
+bool
+History::writeTiles(SDL_RWops* rw, const std::vector<TileDelta>& tiles)
+{
+  bool ok = SDL_WriteLE32(rw, tiles.size());
+  for (auto& delta : tiles) {
+    ok = ok && SDL_WriteLE32(rw, delta.index);
+    ok = ok && SDL_WriteLE32(rw, Uint32(delta.sameAs));
+    ok = ok && SDL_WriteLE32(rw, delta.data.size());
+    ok = ok && SDL_RWwrite(rw, delta.data.data(), 1, delta.data.size()) ==
+                 delta.data.size();
+  }
+  return ok;
+}
+
+bool
+History::readTiles(SDL_RWops* rw, Sint64 size, std::vector<TileDelta>& tiles)
+{
+  constexpr Sint64 HEADER_SZ = 12;
+  if (size < 4) return false;
+  Uint32 count = SDL_ReadLE32(rw);
+  size -= 4;
+  if (count > size / HEADER_SZ) return false;
+  tiles.resize(count);
+  for (int i = 0; i < int(count); ++i) {
+    auto& delta = tiles[i];
+    if (size < HEADER_SZ) return false;
+    delta.index = SDL_ReadLE32(rw);
+    delta.sameAs = Sint32(SDL_ReadLE32(rw));
+    Uint32 dataSz = SDL_ReadLE32(rw);
+    size -= HEADER_SZ;
+    if (delta.sameAs >= i || dataSz > size) return false;
+    // Only tiles holding their own data can be referred to
+    if (delta.sameAs >= 0 && tiles[delta.sameAs].sameAs >= 0) return false;
+    delta.data.resize(dataSz);
+    if (SDL_RWread(rw, delta.data.data(), 1, dataSz) != dataSz) return false;
+    size -= dataSz;
+  }
+  return size == 0;
+}
+
+void
+History::dropFront()
+{
+  baseId = entries.front().id;
+  entries.pop_front();
+  --current;
+}
+
+void
+History::dropBack()
+{
+  entries.pop_back();
+}
+
+void
+History::updateStats()
+{
+  stats.bytesInRam = referenceBytes;
+  stats.bytesOnDisk = 0;
+  stats.entriesInRam = 0;
+  stats.entriesOnDisk = 0;
+  for (auto& entry : entries) {
+    if (entry.isSpilled()) {
+      stats.bytesOnDisk += entry.bytes;
+      stats.entriesOnDisk++;
+    } else {
+      stats.bytesInRam += entry.bytes;
+      stats.entriesInRam++;
+    }
+  }
+}
+
+} // namespace pixedit
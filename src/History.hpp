@@ -0,0 +1,262 @@
+#ifndef PIXEDIT_SRC_HISTORY_INCLUDED
+#define PIXEDIT_SRC_HISTORY_INCLUDED
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL.h>
+#include "Surface.hpp"
+
+namespace pixedit {
+
+/// @brief Counters about the history memory usage
+struct HistoryStats
+{
+  size_t bytesInRam = 0;    ///< @brief Entries in RAM plus the reference
+  size_t bytesOnDisk = 0;   ///< @brief Entries spilled to disk
+  size_t entriesInRam = 0;  ///< @brief Number of entries in RAM
+  size_t entriesOnDisk = 0; ///< @brief Number of entries spilled to disk
+  size_t diskHits = 0;      ///< @brief How many times we loaded from disk
+  double lastHitMs = 0;     ///< @brief Latency of last load from disk
+  double totalHitMs = 0;    ///< @brief Sum of all load latencies
+};
+
+/**
+ * The undo history of a surface
+ *
+ * It keeps an uncompressed copy of the state at the current point, called
+ * reference, and for each step only the tiles that changed. Each changed tile
+ * is stored as the run length encoded XOR between its contents before and
+ * after the step. As XOR is its own inverse the same delta serves both to
+ * undo and redo, and unchanged pixels inside a tile compress to almost
+ * nothing.
+ *
+ * Writers must report the regions they change through touch(). Commit and
+ * restore only look at the tiles touched since the last time, so cancelling
+ * an edit is a copy of just the dirty tiles from the resident reference, and
+ * nothing at all if only scratch surfaces were drawn.
+ *
+ * Entries are accounted by their real size. When the ones in RAM go over the
+ * memory budget, those farthest from the current point are spilled to a temp
+ * file, and loaded back when undo or redo reaches them. When the spilled ones
+ * go over the disk budget, the oldest are dropped.
+ *
+ * Commit only takes the raw XOR of the changed tiles, which is about as cheap
+ * as copying them. Compression, budgeting and spilling happen later on a
+ * worker thread, where deltas with the same content are also hashed and
+ * stored only once per entry (big fills and clears tend to make a lot of
+ * them). Anything needing the entries as they are on disk or in RAM
+ * (undo, redo, reset, budget changes) waits for it to finish first.
+ */
+class History
+{
+public:
+  /// @brief The tile side, in pixels
+  static constexpr int TILE_SIZE = 64;
+
+  /// @brief An identifier for a state, unique within this history
+  using StateId = Uint64;
+
+private:
+  struct TileDelta
+  {
+    Uint32 index;
+    std::vector<Uint8> data;
+    /// @brief An earlier delta in the same entry with equal data, or -1
+    int sameAs = -1;
+  };
+
+  struct Entry
+  {
+    StateId id;
+    std::vector<TileDelta> tiles;
+    /// @brief When the geometry changed, the surface on the other side
+    Surface replaced;
+    size_t bytes = 0;
+    std::string spillFilename;
+    /// @brief The tiles still hold the raw XOR, to be encoded by the worker
+    bool pending = false;
+    int unitSz = 1;
+
+    Entry(StateId id)
+      : id(id)
+    {
+    }
+    Entry(Entry&& rhs);
+    Entry& operator=(Entry&& rhs);
+    ~Entry();
+
+    bool isSpilled() const { return !spillFilename.empty(); }
+  };
+
+  Surface reference;
+  std::deque<Entry> entries;
+  size_t current = 0;
+  SDL_Rect touched{0, 0, 0, 0};
+  StateId baseId = 0;
+  StateId nextId = 1;
+  size_t referenceBytes = 0;
+  size_t memoryBudget;
+  size_t diskBudget;
+  HistoryStats stats;
+
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  std::thread worker;
+  size_t pendingCount = 0;
+  bool stopping = false;
+
+public:
+  History();
+
+  History(size_t memoryBudget, size_t diskBudget);
+
+  History(const History&) = delete;
+  History& operator=(const History&) = delete;
+
+  ~History();
+
+  /// @brief Discard all entries and start from the given state
+  void reset(Surface surface);
+
+  /// @brief Take the touched region of surface as the new state, without steps
+  void rebase(const Surface& surface);
+
+  /// @brief Mark a region as possibly changed since the current point
+  void touch(const SDL_Rect& rect);
+
+  /// @brief Mark the whole surface as possibly changed
+  void touchAll();
+
+  /**
+   * Record the changes on the touched region from the current point
+   *
+   * Any entry after the current point is discarded.
+   * @return true if something changed and an entry was added.
+   */
+  bool commit(const Surface& surface);
+
+  /**
+   * Bring back the touched region to the state on the current point
+   *
+   * Only tiles that differ from the reference are written. The surface is
+   * replaced if its geometry no longer matches.
+   * @return the region of surface that was written, in pixels.
+   */
+  SDL_Rect restore(Surface& surface);
+
+  /**
+   * Go back a step and restore surface to it
+   *
+   * @return the region of surface that changed, or nothing if there was no
+   * step to undo.
+   */
+  std::optional<SDL_Rect> undo(Surface& surface);
+
+  /**
+   * Go forward a step and restore surface to it
+   *
+   * @return the region of surface that changed, or nothing if there was no
+   * step to redo.
+   */
+  std::optional<SDL_Rect> redo(Surface& surface);
+
+  bool canUndo() const;
+
+  bool canRedo() const;
+
+  /// @brief The id of the state on the current point
+  StateId getStateId() const;
+
+  /// @brief The number of steps currently stored
+  size_t size() const;
+
+  bool empty() const { return !reference; }
+
+  /// @brief The id of the state before the first step
+  StateId getBaseId() const;
+
+  /// @brief The id of the state after the step at index
+  StateId getStepId(size_t index) const;
+
+  /// @brief How many steps are applied to get to the current point
+  size_t getPosition() const;
+
+  /**
+   * Build the state after the given number of steps
+   *
+   * @return the state or null if a step in between changed the geometry.
+   */
+  Surface getStateAt(size_t position);
+
+  /// @brief True if the step at index changed the geometry
+  bool changesGeometry(size_t index) const;
+
+  /**
+   * Write the step at index, in the same format used to spill it
+   *
+   * @return false if it can not be written, as when it changes geometry.
+   */
+  bool writeStep(size_t index, SDL_RWops* rw);
+
+  /// @brief Read size bytes written by writeStep() as a step after the last
+  bool appendStep(SDL_RWops* rw, Sint64 size);
+
+  /// @brief Wait until the worker processed all committed steps
+  void flush();
+
+  /// @brief A snapshot of the counters, they may lag behind the worker
+  HistoryStats getStats() const;
+
+  size_t getMemoryBudget() const { return memoryBudget; }
+
+  /// @brief Set max bytes for entries in RAM, spilling the excess
+  void setMemoryBudget(size_t value);
+
+  size_t getDiskBudget() const { return diskBudget; }
+
+  /// @brief Set max bytes for entries on disk, dropping the excess
+  void setDiskBudget(size_t value);
+
+private:
+  std::unique_lock<std::mutex> waitIdle();
+
+  void work();
+
+  /// @brief Move the reference across entry and copy it to surface
+  /// @return the region of surface that was written, in pixels
+  SDL_Rect apply(Entry& entry, Surface& surface);
+
+  /// @brief Apply tiles to surface, that must have the reference geometry
+  void xorTiles(Surface& surface, const std::vector<TileDelta>& tiles) const;
+
+  /// @brief The tiles of entry, read into buffer if it was spilled
+  const std::vector<TileDelta>& tilesOf(const Entry& entry,
+                                        std::vector<TileDelta>& buffer) const;
+
+  void enforceBudgets();
+
+  bool spill(Entry& entry);
+
+  static bool writeTiles(SDL_RWops* rw, const std::vector<TileDelta>& tiles);
+
+  static bool readTiles(SDL_RWops* rw,
+                        Sint64 size,
+                        std::vector<TileDelta>& tiles);
+
+  void unspill(Entry& entry);
+
+  void dropFront();
+
+  void dropBack();
+
+  void updateStats();
+};
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_HISTORY_INCLUDED */
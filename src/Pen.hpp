@@ -7,29 +7,38 @@
 
 namespace pixedit {
 
+class Stamp;
+
 struct Pen
 {
   enum Type
   {
     DOT,
     BOX,
+    STAMP,
   };
   Type type;
   int w, h;
+  const Stamp* stamp; ///< @brief The picture put by a STAMP pen
 
   constexpr Pen()
     : type(DOT)
     , w(1)
     , h(1)
+    , stamp(nullptr)
   {
   }
   constexpr Pen(int w, int h)
     : type((w == 1 && h == 1) ? DOT : BOX)
     , w(w)
     , h(h)
+    , stamp(nullptr)
   {
     assert(w > 0 && h > 0);
   }
+
+  /// @brief A pen as large as stamp, putting it. The stamp must outlive it
+  explicit Pen(const Stamp& stamp);
 };
 
 } // namespace pixedit
@@ -4,10 +4,6 @@
 
 namespace pixedit {
 
-namespace defaults {
-extern const unsigned HISTORY_MAX;
-} // namespace defaults
-
 bool
 PictureFile::load(PictureBuffer& buffer)
 {
@@ -37,9 +33,13 @@ PictureBuffer::load(const std::string& filename)
 bool
 PictureBuffer::save(bool force)
 {
-  if (!force && lastSave == historyPoint) return false;
-  if (!file.save(*this)) return false;
-  lastSave = historyPoint;
+  if (!force && lastSave == getStateId()) return false;
+  if (journal && saverForFile(file.name) == savers::PIX) {
+    if (!journal->save(file.name, history)) return false;
+  } else if (!file.save(*this)) {
+    return false;
+  }
+  lastSave = getStateId();
   return true;
 }
 bool
@@ -65,48 +65,103 @@ PictureBuffer::makeSnapshot()
 {
   if (!surface) return;
   if (selectionSurface) clearSelection();
-  if (historyPoint != history.end()) {
-    history.erase(++historyPoint, history.end());
+  if (history.empty()) {
+    history.reset(surface);
+  } else if (commandLog) {
+    commandLog->commit(surface);
+    history.rebase(surface);
+  } else {
+    history.commit(surface);
   }
-  historyPoint = history.emplace(history.end(), surface);
-  if (history.size() > defaults::HISTORY_MAX) history.pop_front();
 }
 
-void
+SDL_Rect
 PictureBuffer::refresh()
 {
-  if (!surface || history.empty() || historyPoint == history.end()) return;
+  if (!surface || history.empty()) return {0, 0, 0, 0};
   if (selectionSurface) clearSelection();
-  surface = historyPoint->recover();
+  return history.restore(surface);
 }
 
-bool
+std::optional<SDL_Rect>
 PictureBuffer::undo()
 {
-  if (!surface || history.empty() || historyPoint == history.begin()) {
-    return false;
+  if (!surface) { return std::nullopt; }
+  if (commandLog) {
+    if (!commandLog->canUndo()) { return std::nullopt; }
+    if (selectionSurface) clearSelection();
+    // The log rebuilds the whole surface
+    surface = commandLog->undo();
+    history.reset(surface);
+    return SDL_Rect{0, 0, surface.getW(), surface.getH()};
   }
-  --historyPoint;
-  refresh();
-  return true;
+  if (!history.canUndo()) { return std::nullopt; }
+  if (selectionSurface) clearSelection();
+  return history.undo(surface);
 }
 
-bool
+std::optional<SDL_Rect>
 PictureBuffer::redo()
 {
-  if (!surface || history.empty()) { return false; }
-  ++historyPoint;
-  if (historyPoint == history.end()) {
-    --historyPoint;
-    return false;
+  if (!surface) { return std::nullopt; }
+  if (commandLog) {
+    if (!commandLog->canRedo()) { return std::nullopt; }
+    if (selectionSurface) clearSelection();
+    surface = commandLog->redo();
+    history.reset(surface);
+    return SDL_Rect{0, 0, surface.getW(), surface.getH()};
   }
-  refresh();
-  return false;
+  if (!history.canRedo()) { return std::nullopt; }
+  if (selectionSurface) clearSelection();
+  return history.redo(surface);
+}
+
+void
+PictureBuffer::enableCommandLog(bool enable)
+{
+  if (!surface || enable == bool(commandLog)) return;
+  bool dirty = isDirty();
+  if (enable) {
+    commandLog = std::make_unique<CommandLog>();
+    commandLog->reset(surface);
+  } else {
+    commandLog.reset();
+  }
+  history.reset(surface);
+  lastSave = dirty ? 0 : getStateId();
+}
+
+void
+PictureBuffer::enableJournal(bool enable)
+{
+  if (enable == bool(journal)) return;
+  if (enable) {
+    journal = std::make_unique<PixJournal>();
+  } else {
+    journal.reset();
+  }
+}
+
+bool
+PictureBuffer::loadJournal(const std::string& filename)
+{
+  auto loaded = std::make_unique<PixJournal>();
+  Surface loadedSurface;
+  if (!loaded->load(filename, history, loadedSurface)) return false;
+  surface = loadedSurface;
+  clearSelection();
+  commandLog.reset();
+  lastSave = history.getStateId();
+  if (loaded->size() > 0 || !loaded->getFilename().empty()) {
+    journal = std::move(loaded);
+  }
+  return true;
 }
 
 void
 PictureBuffer::persistSelection()
 {
+  touchUnrecorded(selectionRect);
   if (selectionMask) {
     selectionMask.setColorIndex(0, {0, 0, 0, 0});
     selectionMask.setColorKey(1);
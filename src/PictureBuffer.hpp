@@ -1,13 +1,15 @@
 #ifndef PIXEDIT_SRC_PICTURE_BUFFER_INCLUDED
 #define PIXEDIT_SRC_PICTURE_BUFFER_INCLUDED
 
-#include <list>
 #include <memory>
+#include <optional>
 #include <string>
 #include <SDL.h>
+#include "CommandLog.hpp"
+#include "History.hpp"
 #include "PictureFile.hpp"
+#include "PixJournal.hpp"
 #include "Surface.hpp"
-#include "utils/TempSurface.hpp"
 
 namespace pixedit {
 /**
@@ -18,9 +20,10 @@ class PictureBuffer
 private:
   PictureFile file;
   Surface surface;
-  std::list<TempSurface> history;
-  std::list<TempSurface>::iterator historyPoint = history.end();
-  std::list<TempSurface>::iterator lastSave = history.end();
+  History history;
+  History::StateId lastSave = 0;
+  std::unique_ptr<CommandLog> commandLog;
+  std::unique_ptr<PixJournal> journal;
   Surface selectionSurface;
   Surface selectionMask;
   SDL_Rect selectionRect{0, 0, 10, 10};
@@ -35,15 +38,15 @@ public:
     , surface(surface)
   {
     if (surface) {
-      makeSnapshot();
-      if (!dirty) { lastSave = history.begin(); }
+      history.reset(surface);
+      if (!dirty) { lastSave = history.getStateId(); }
     }
   }
 
   static std::unique_ptr<PictureBuffer> load(const std::string& filename);
 
   /// @brief True if this needs saving
-  bool isDirty() const { return lastSave != historyPoint; }
+  bool isDirty() const { return lastSave != getStateId(); }
 
   bool save(bool force = false);
 
@@ -53,11 +56,45 @@ public:
 
   void makeSnapshot();
 
-  void refresh();
+  /// @brief Bring back the last snapshot, returning the region it changed
+  SDL_Rect refresh();
 
-  bool undo();
+  /**
+   * Go back a step
+   *
+   * @return the region of the surface that changed, or nothing if there was
+   * no step to undo.
+   */
+  std::optional<SDL_Rect> undo();
 
-  bool redo();
+  /**
+   * Go forward a step
+   *
+   * @return the region of the surface that changed, or nothing if there was
+   * no step to redo.
+   */
+  std::optional<SDL_Rect> redo();
+
+  HistoryStats getHistoryStats() const { return history.getStats(); }
+
+  /// @brief The command log, if it is used for undo instead of the history
+  CommandLog* getCommandLog() const { return commandLog.get(); }
+
+  /// @brief Switch undo between command log and history, dropping all steps
+  void enableCommandLog(bool enable = true);
+
+  /// @brief True if saving as .pix also keeps the history on the file
+  bool hasJournal() const { return bool(journal); }
+
+  /// @brief Keep the history on the file when saving as .pix
+  void enableJournal(bool enable = true);
+
+  /**
+   * Replace the contents and history by the ones on a .pix file
+   *
+   * The journal is enabled if the file had one.
+   */
+  bool loadJournal(const std::string& filename);
 
   constexpr const std::string& getFilename() const { return file.name; }
 
@@ -65,7 +102,25 @@ public:
 
   Surface getSurface() const { return surface; }
 
-  void setSurface(Surface value) { surface = value; }
+  void setSurface(Surface value)
+  {
+    surface = value;
+    history.touchAll();
+    if (commandLog) commandLog->markUnreplayable();
+  }
+
+  /// @brief Report a region of the surface as changed since the last snapshot
+  void touch(const SDL_Rect& rect) { history.touch(rect); }
+
+  /// @brief Report a change made outside the tools input
+  void touchUnrecorded(const SDL_Rect& rect)
+  {
+    history.touch(rect);
+    if (commandLog) commandLog->markUnreplayable();
+  }
+
+  /// @brief Report the whole surface as changed since the last snapshot
+  void touchAll() { history.touchAll(); }
 
   int getW() const { return surface.getW(); }
   int getH() const { return surface.getH(); }
@@ -88,15 +143,23 @@ public:
     selectionSurface = std::move(surface);
     selectionRect = rect;
     selectionMask.reset();
+    touchUnrecorded(rect);
   }
   void setSelection(Surface surface, SDL_Rect rect, Surface mask)
   {
     selectionSurface = std::move(surface);
     selectionRect = rect;
     selectionMask = std::move(mask);
+    touchUnrecorded(rect);
   }
 
   void persistSelection();
+
+private:
+  Uint64 getStateId() const
+  {
+    return commandLog ? commandLog->getStateId() : history.getStateId();
+  }
 };
 
 } // namespace pixedit
@@ -11,93 +11,131 @@ PictureView::updatePreview(SDL_Renderer* renderer)
   changed = false;
   if (!buffer || !buffer->getSurface()) return;
   if (!scratchEnabled) canvas.setSurface(buffer->getSurface());
-  auto createPreview = [renderer, w = buffer->getW(), h = buffer->getH()] {
-    auto t = SDL_CreateTexture(
-      renderer, SDL_PIXELFORMAT_ABGR32, SDL_TEXTUREACCESS_STREAMING, w, h);
-    SDL_SetTextureBlendMode(t, SDL_BLENDMODE_BLEND);
-    return t;
-  };
   movingMode = false;
   if (!renderer) { return; }
-  if (preview) {
-    int w, h;
-    SDL_QueryTexture(preview, nullptr, nullptr, &w, &h);
-    if (w < buffer->getW() || h < buffer->getH()) {
-      SDL_DestroyTexture(preview);
-      preview = createPreview();
+  if (preview.resize(buffer->getW(), buffer->getH())) preview.invalidate();
+  overlay.resize(buffer->getW(), buffer->getH());
+
+  Surface selection;
+  if (buffer->hasSelection()) selection = buffer->getSelectionSurface();
+  if (selection.get() != previewSelection.get()) {
+    // A new selection may have been cut out of the picture
+    if (selection) preview.invalidate(buffer->getSelectionRect());
+    previewSelection = selection;
+    selectionOutdated = true;
+  }
+  if (selectionOutdated && selection) {
+    // Kept while large enough, so only part of it may be used
+    int w = 0, h = 0;
+    if (selectionPreview) {
+      SDL_QueryTexture(selectionPreview, nullptr, nullptr, &w, &h);
     }
-  } else {
-    SDL_DestroyTexture(preview);
-    preview = createPreview();
+    if (w < selection.getW() || h < selection.getH()) {
+      SDL_DestroyTexture(selectionPreview);
+      selectionPreview = SDL_CreateTexture(renderer,
+                                           SDL_PIXELFORMAT_ABGR32,
+                                           SDL_TEXTUREACCESS_STREAMING,
+                                           selection.getW(),
+                                           selection.getH());
+      SDL_SetTextureBlendMode(selectionPreview, SDL_BLENDMODE_BLEND);
+    }
+    uploadSelection();
+  }
+  selectionOutdated = false;
+  uploadTiles(renderer);
+}
+
+/// @brief Copy rect of source as is, without blending it over dst
+static void
+copyRect(Surface& dst, Surface source, const SDL_Rect& rect)
+{
+  dst.fillRect({0, 0, rect.w, rect.h}, 0);
+  auto mode = source.getBlendMode();
+  source.setBlendMode(SDL_BLENDMODE_NONE);
+  dst.blit(source, {0, 0}, rect);
+  source.setBlendMode(mode);
+}
+
+void
+PictureView::uploadTiles(SDL_Renderer* renderer)
+{
+  if (!renderer || !buffer || !buffer->getSurface()) return;
+  auto visible = visibleRect(effectiveRect());
+  preview.update(renderer, visible, [&](Surface& dst, const SDL_Rect& rect) {
+    dst.fillRect({0, 0, rect.w, rect.h}, 0);
+    dst.blit(buffer->getSurface(), {0, 0}, rect);
+  });
+  if (scratchEnabled) {
+    overlay.update(
+      renderer, visible, [&](Surface& dst, const SDL_Rect& rect) {
+        copyRect(dst, scratch, rect);
+      });
   }
-  SDL_Rect dstRect{0, 0, buffer->getW(), buffer->getH()};
-  Surface previewSurface;
+}
+
+void
+PictureView::uploadSelection()
+{
+  auto selection = buffer->getSelectionSurface();
+  SDL_Rect rect{0, 0, selection.getW(), selection.getH()};
+  Surface selectionSurface;
   {
     SDL_Surface* temp;
-    SDL_LockTextureToSurface(preview, &dstRect, &temp);
-    previewSurface = Surface{temp, false};
+    SDL_LockTextureToSurface(selectionPreview, &rect, &temp);
+    selectionSurface = Surface{temp, false};
   }
-
-  previewSurface.fillRect(dstRect, 0);
-  previewSurface.blit(buffer->getSurface());
-  if (buffer->hasSelection()) {
-    auto selection = buffer->getSelectionSurface();
-    auto mask = buffer->getSelectionMask();
-    if (mask && !transparent) {
-      mask.setColorKey(1);
-      mask.setColorIndex(0, canvas.getColorB());
-      selection.blit(mask);
-      selection.setColorKey(canvas.getColorB());
-    }
-    previewSurface.blitScaled(buffer->getSelectionSurface(),
-                              buffer->getSelectionRect());
-    if (mask && !transparent) { selection.unsetColorKey(); }
+  auto mask = buffer->getSelectionMask();
+  if (mask && !transparent) {
+    mask.setColorKey(1);
+    mask.setColorIndex(0, canvas.getColorB());
+    selection.blit(mask);
+    selection.setColorKey(canvas.getColorB());
   }
-  if (scratchEnabled) { previewSurface.blit(scratch); }
-  SDL_UnlockTexture(preview);
+  copyRect(selectionSurface, selection, rect);
+  if (mask && !transparent) { selection.unsetColorKey(); }
+  SDL_UnlockTexture(selectionPreview);
 }
 
+/**
+ * Fill rect with a checkerboard, only where it is inside clip
+ *
+ * The squares start from the corner of rect. All those of color2 are sent
+ * in one batch, as there can be tens of thousands when zoomed in.
+ */
 static void
 renderCheckerBoard(SDL_Renderer* renderer,
                    const SDL_FRect& rect,
+                   const SDL_Rect& clip,
                    float squareSize,
                    SDL_Color color1,
                    SDL_Color color2)
 {
+  float x1 = std::max(rect.x, float(clip.x));
+  float y1 = std::max(rect.y, float(clip.y));
+  float x2 = std::min(rect.x + rect.w, float(clip.x + clip.w));
+  float y2 = std::min(rect.y + rect.h, float(clip.y + clip.h));
+  if (x1 >= x2 || y1 >= y2) return;
+  SDL_FRect visible{x1, y1, x2 - x1, y2 - y1};
   SDL_SetRenderDrawColor(renderer, color1.r, color1.g, color1.b, 255);
-  SDL_RenderFillRectF(renderer, &rect);
-  SDL_SetRenderDrawColor(renderer, color2.r, color2.g, color2.b, 255);
-  SDL_FRect rect2 = {rect.x, rect.y, squareSize, squareSize};
-  bool oddRow = false;
-  bool oddCol = false;
-  float x2 = rect.x + rect.w;
-  float y2 = rect.y + rect.h;
-  for (; rect2.y + rect2.h <= y2; rect2.y += rect2.h) {
-    for (; rect2.x + rect2.w <= x2; rect2.x += rect2.w) {
-      if (oddCol == oddRow) SDL_RenderFillRectF(renderer, &rect2);
-      oddCol = !oddCol;
-    }
-    if (rect2.x < x2 && oddCol == oddRow) {
-      rect2.w = x2 - rect2.x;
-      SDL_RenderFillRectF(renderer, &rect2);
-      rect2.w = squareSize;
-    }
-    oddRow = !oddRow;
-    oddCol = false;
-    rect2.x = rect.x;
-  }
-  if (rect2.y < y2) {
-    rect2.h = y2 - rect2.y;
-    for (; rect2.x + rect2.w <= x2; rect2.x += rect2.w) {
-      if (oddCol == oddRow) SDL_RenderFillRectF(renderer, &rect2);
-      oddCol = !oddCol;
-    }
-    if (rect2.x < x2 && oddCol == oddRow) {
-      rect2.w = x2 - rect2.x;
-      SDL_RenderFillRectF(renderer, &rect2);
-      rect2.w = squareSize;
+  SDL_RenderFillRectF(renderer, &visible);
+
+  int colBeg = int((x1 - rect.x) / squareSize);
+  int colEnd = int(ceil((x2 - rect.x) / squareSize));
+  int rowBeg = int((y1 - rect.y) / squareSize);
+  int rowEnd = int(ceil((y2 - rect.y) / squareSize));
+  std::vector<SDL_FRect> squares;
+  squares.reserve(size_t(colEnd - colBeg + 1) / 2 * (rowEnd - rowBeg));
+  for (int row = rowBeg; row < rowEnd; ++row) {
+    float top = std::max(y1, rect.y + row * squareSize);
+    float bottom = std::min(y2, rect.y + (row + 1) * squareSize);
+    for (int col = colBeg + (colBeg + row) % 2; col < colEnd; col += 2) {
+      float left = std::max(x1, rect.x + col * squareSize);
+      float right = std::min(x2, rect.x + (col + 1) * squareSize);
+      squares.push_back({left, top, right - left, bottom - top});
     }
   }
+  SDL_SetRenderDrawColor(renderer, color2.r, color2.g, color2.b, 255);
+  SDL_RenderFillRectsF(renderer, squares.data(), int(squares.size()));
 }
 
 float
@@ -136,42 +174,134 @@ PictureView::effectiveOffset() const
   return effectiveOffset;
 }
 
+SDL_FRect
+PictureView::effectiveRect() const
+{
+  auto size = effectiveSize();
+  auto offset = effectiveOffset();
+  return {
+    viewport.x + offset.x + (viewport.w - size.x) / 2.f,
+    viewport.y + offset.y + (viewport.h - size.y) / 2.f,
+    size.x,
+    size.y,
+  };
+}
+
+SDL_Rect
+PictureView::visibleRect(const SDL_FRect& pictureRect) const
+{
+  float scale = effectiveScale();
+  int x1 = std::max(0, int(floor((viewport.x - pictureRect.x) / scale)));
+  int y1 = std::max(0, int(floor((viewport.y - pictureRect.y) / scale)));
+  int x2 = std::min(
+    buffer->getW(),
+    int(ceil((viewport.x + viewport.w - pictureRect.x) / scale)));
+  int y2 = std::min(
+    buffer->getH(),
+    int(ceil((viewport.y + viewport.h - pictureRect.y) / scale)));
+  return {x1, y1, std::max(0, x2 - x1), std::max(0, y2 - y1)};
+}
+
 void
 PictureView::render(SDL_Renderer* renderer) const
 {
   if (!buffer || !buffer->getSurface()) return;
   float scale = effectiveScale();
-  SDL_FPoint scaledSz = {
-    scale * buffer->getW(),
-    scale * buffer->getH(),
-  };
-  auto offset = effectiveOffset();
-  SDL_Rect srcRect{0, 0, buffer->getW(), buffer->getH()};
+  auto dstRect = effectiveRect();
+  auto visible = visibleRect(dstRect);
+  renderCheckerBoard(renderer,
+                     dstRect,
+                     viewport,
+                     checkerSize,
+                     checkerColors[0],
+                     checkerColors[1]);
+  preview.render(renderer, dstRect, visible);
+  if (buffer->hasSelection() && previewSelection) {
+    renderSelection(renderer, dstRect);
+  }
+  if (scratchEnabled) { overlay.render(renderer, dstRect, visible); }
+  if (grid && scale >= 3) { renderGrid(renderer, dstRect); }
+}
+
+void
+PictureView::renderGrid(SDL_Renderer* renderer,
+                        const SDL_FRect& pictureRect) const
+{
+  auto& cache = gridCache;
+  auto& picture = cache.picture;
+  if (picture.x != pictureRect.x || picture.y != pictureRect.y ||
+      picture.w != pictureRect.w || picture.h != pictureRect.h ||
+      !SDL_RectEquals(&cache.viewport, &viewport)) {
+    cache.picture = pictureRect;
+    cache.viewport = viewport;
+    cache.lines.clear();
+    float scale = effectiveScale();
+    float x1 = std::max(pictureRect.x, float(viewport.x));
+    float y1 = std::max(pictureRect.y, float(viewport.y));
+    float x2 = std::min(pictureRect.x + pictureRect.w,
+                        float(viewport.x + viewport.w));
+    float y2 = std::min(pictureRect.y + pictureRect.h,
+                        float(viewport.y + viewport.h));
+    // Each line is the last pixel row or column of a picture pixel
+    auto firstLine = [scale](float start, float visible) {
+      return std::max(0.f, floor((visible - start) / scale) - 1);
+    };
+    if (x1 < x2 && y1 < y2) {
+      float k = firstLine(pictureRect.y, y1);
+      for (float yy = pictureRect.y + (k + 1) * scale - 1; yy < y2;
+           yy += scale) {
+        cache.lines.push_back({x1, yy, x2 - x1, 1});
+      }
+      k = firstLine(pictureRect.x, x1);
+      for (float xx = pictureRect.x + (k + 1) * scale - 1; xx < x2;
+           xx += scale) {
+        cache.lines.push_back({xx, y1, 1, y2 - y1});
+      }
+    }
+  }
+  SDL_SetRenderDrawColor(renderer, 127, 127, 127, 255);
+  SDL_RenderFillRectsF(
+    renderer, cache.lines.data(), int(cache.lines.size()));
+}
+
+void
+PictureView::renderSelection(SDL_Renderer* renderer,
+                             const SDL_FRect& pictureRect) const
+{
+  float scale = effectiveScale();
+  auto& rect = buffer->getSelectionRect();
+  SDL_Rect srcRect{0, 0, previewSelection.getW(), previewSelection.getH()};
   SDL_FRect dstRect{
-    viewport.x + offset.x + (viewport.w - scaledSz.x) / 2.f,
-    viewport.y + offset.y + (viewport.h - scaledSz.y) / 2.f,
-    scaledSz.x,
-    scaledSz.y,
+    pictureRect.x + rect.x * scale,
+    pictureRect.y + rect.y * scale,
+    rect.w * scale,
+    rect.h * scale,
   };
-  renderCheckerBoard(
-    renderer, dstRect, checkerSize, checkerColors[0], checkerColors[1]);
-  SDL_RenderCopyF(renderer, preview, &srcRect, &dstRect);
-  if (grid && scale >= 3) {
-    SDL_SetRenderDrawColor(renderer, 127, 127, 127, 255);
-    float yLimit = dstRect.y + scaledSz.y;
-    float xLimit = dstRect.x + scaledSz.x;
-    for (float yy = dstRect.y + scale - 1; yy < yLimit; yy += scale) {
-      SDL_RenderDrawLineF(renderer, dstRect.x, yy, xLimit - 1, yy);
-    }
-    for (float xx = dstRect.x + scale - 1; xx < xLimit; xx += scale) {
-      SDL_RenderDrawLineF(renderer, xx, dstRect.y, xx, yLimit - 1);
-    }
+  if (rect.x >= 0 && rect.y >= 0 && rect.x + rect.w <= buffer->getW() &&
+      rect.y + rect.h <= buffer->getH()) {
+    SDL_RenderCopyF(renderer, selectionPreview, &srcRect, &dstRect);
+    return;
   }
+  // What lies out of the picture is not shown, as when blitted on it
+  SDL_Rect clip{
+    int(floor(pictureRect.x)),
+    int(floor(pictureRect.y)),
+    int(ceil(pictureRect.x + pictureRect.w)) - int(floor(pictureRect.x)),
+    int(ceil(pictureRect.y + pictureRect.h)) - int(floor(pictureRect.y)),
+  };
+  bool clipped = SDL_RenderIsClipEnabled(renderer);
+  SDL_Rect oldClip;
+  SDL_RenderGetClipRect(renderer, &oldClip);
+  if (clipped) SDL_IntersectRect(&clip, &oldClip, &clip);
+  SDL_RenderSetClipRect(renderer, &clip);
+  SDL_RenderCopyF(renderer, selectionPreview, &srcRect, &dstRect);
+  SDL_RenderSetClipRect(renderer, clipped ? &oldClip : nullptr);
 }
 
 void
 PictureView::enableScratch(bool enable)
 {
+  collectDirty();
   if (!buffer) {
     scratchEnabled = false;
     return;
@@ -180,17 +310,35 @@ PictureView::enableScratch(bool enable)
   scratchEnabled = enable;
   changed = true;
   if (!enable) {
+    invalidateOverlay(scratchDirty);
     canvas.setSurface(buffer->getSurface());
     scratch.reset();
   } else if (scratch && scratch.getW() >= buffer->getW() &&
              scratch.getH() >= buffer->getH()) {
-    scratch.fillRect({0, 0, buffer->getW(), buffer->getH()}, 0);
+    invalidateOverlay(scratchDirty);
+    scratch.fillRect(scratchDirty, 0);
     canvas.setSurface(scratch);
   } else {
     scratch = Surface::create(buffer->getW(), buffer->getH());
     SDL_assert(scratch);
     canvas.setSurface(scratch);
   }
+  scratchDirty = {0, 0, 0, 0};
+}
+
+void
+PictureView::collectDirty()
+{
+  auto& dirty = canvas.getDirtyRect();
+  if (SDL_RectEmpty(&dirty)) return;
+  if (scratchEnabled) {
+    SDL_UnionRect(&scratchDirty, &dirty, &scratchDirty);
+    invalidateOverlay(dirty);
+  } else if (buffer) {
+    buffer->touch(dirty);
+    invalidatePreview(dirty);
+  }
+  canvas.resetDirtyRect();
 }
 
 inline std::optional<IdRef>
@@ -214,12 +362,12 @@ PictureView::update(SDL_Renderer* renderer)
     tool = toolDesc.build();
   }
   if (buffer != newBuffer) {
+    invalidatePreview();
     if (!buffer) {
       buffer = newBuffer;
       updatePreview(renderer);
       return;
     }
-    changed = true;
     if (tool) {
       if (editing) { cancelEdit(); }
       tool(*this, PictureEvent::RESET);
@@ -259,7 +407,10 @@ PictureView::update(SDL_Renderer* renderer)
   } else if (oldState.middle) {
     movingMode = false;
   } else if (tool != nullptr) {
+    auto log = buffer->getCommandLog();
+    if (log) { log->record(*this); }
     tool(*this, event);
+    if (log && !editing) { log->discard(); }
   } else if (event == PictureEvent::LEFT) {
     movingMode = true;
   } else if (event != PictureEvent::NONE) {
@@ -280,7 +431,11 @@ PictureView::update(SDL_Renderer* renderer)
   }
 
   oldState = state;
-  if (changed) { updatePreview(renderer); }
+  if (changed) {
+    updatePreview(renderer);
+  } else {
+    uploadTiles(renderer);
+  }
 }
 
 void
@@ -302,6 +457,7 @@ PictureView::setTransparent(bool value)
       selection.unsetColorKey();
     }
   }
+  selectionOutdated = true;
   changed = true;
 }
 
@@ -350,7 +506,7 @@ void
 PictureView::persistSelection()
 {
   if (!buffer || !buffer->hasSelection()) return;
-  changed = true;
+  invalidatePreview(buffer->getSelectionRect());
   buffer->persistSelection();
 }
 
@@ -3,10 +3,12 @@
 
 #include <memory>
 #include <optional>
+#include <vector>
 #include <SDL.h>
 #include "Canvas.hpp"
 #include "MouseState.hpp"
 #include "PictureBuffer.hpp"
+#include "TiledTexture.hpp"
 #include "ToolDescription.hpp"
 
 namespace pixedit {
@@ -16,8 +18,13 @@ class PictureView
   SDL_Rect viewport;
   std::shared_ptr<PictureBuffer> buffer, newBuffer;
   MouseState oldState{};
-  SDL_Texture* preview = nullptr;
+  TiledTexture preview;
+  TiledTexture overlay;
+  SDL_Texture* selectionPreview = nullptr;
   Surface scratch;
+  SDL_Rect scratchDirty{0, 0, 0, 0};
+  Surface previewSelection;
+  bool selectionOutdated = false;
 
   bool scratchEnabled = false;
   bool changed = false;
@@ -33,19 +40,36 @@ class PictureView
   int checkerSize = 16;
   bool grid = true;
 
+  /// @brief The grid lines, kept while the picture and viewport stay put
+  struct GridCache
+  {
+    SDL_FRect picture{0, 0, 0, 0};
+    SDL_Rect viewport{0, 0, 0, 0};
+    std::vector<SDL_FRect> lines;
+  };
+  mutable GridCache gridCache;
+
 public:
   SDL_FPoint offset{0};
   float scale{1.f};
   MouseState state{};
   Canvas canvas;
   bool fillSelectedOut = false;
+  /// @brief Max channel difference for the flood fill to spread
+  int fillTolerance = 0;
+  /// @brief If false, flood fill changes all matching pixels, connected or not
+  bool fillContiguous = true;
 
   PictureView(const SDL_Rect& viewport = {0})
     : viewport(viewport)
   {
   }
 
-  void previewEdit() { changed = true; }
+  void previewEdit()
+  {
+    changed = true;
+    collectDirty();
+  }
 
   void beginEdit()
   {
@@ -70,7 +94,7 @@ public:
     if (!buffer || !editing) return;
     editing = false;
     oldState.left = oldState.right = (oldState.left || oldState.right);
-    buffer->refresh();
+    invalidatePreview(buffer->refresh());
     previewEdit();
   }
 
@@ -78,16 +102,36 @@ public:
   {
     if (!buffer) return false;
     cancelEdit();
-    changed = true;
-    return buffer->undo();
+    auto changed = buffer->undo();
+    if (!changed) return false;
+    invalidatePreview(*changed);
+    return true;
   }
 
   bool redo()
   {
     if (!buffer) return false;
     cancelEdit();
+    auto changed = buffer->redo();
+    if (!changed) return false;
+    invalidatePreview(*changed);
+    return true;
+  }
+
+  /// @brief Redraw rect of the picture on the preview, on the next update
+  void invalidatePreview(const SDL_Rect& rect)
+  {
+    if (SDL_RectEmpty(&rect)) return;
+    preview.invalidate(rect);
+    changed = true;
+  }
+
+  /// @brief Redraw the whole preview and selection on the next update
+  void invalidatePreview()
+  {
+    preview.invalidate();
+    selectionOutdated = true;
     changed = true;
-    return buffer->redo();
   }
 
   constexpr bool isScratchEnabled() const { return scratchEnabled; }
@@ -104,13 +148,16 @@ public:
 
   SDL_FPoint effectiveOffset() const;
 
+  /// @brief Where the picture is drawn, in renderer coordinates
+  SDL_FRect effectiveRect() const;
+
   float setScale(float value)
   {
     scale = value;
     return scale = effectiveScale();
   }
 
-  Id getToolId() { return toolId; }
+  Id getToolId() const { return toolId; }
 
   void setToolId(IdRef id) { nextToolId = id; }
 
@@ -141,6 +188,33 @@ public:
 
 private:
   void updatePreview(SDL_Renderer* renderer);
+
+  /// @brief Upload what changed of the picture and scratch, where visible
+  void uploadTiles(SDL_Renderer* renderer);
+
+  /// @brief The part of the picture inside the viewport
+  SDL_Rect visibleRect(const SDL_FRect& pictureRect) const;
+
+  /// @brief Upload the floating selection to selectionPreview
+  void uploadSelection();
+
+  /// @brief Draw a line after each pixel of the picture, as far as visible
+  void renderGrid(SDL_Renderer* renderer, const SDL_FRect& pictureRect) const;
+
+  /// @brief Draw the floating selection where it is over the picture
+  void renderSelection(SDL_Renderer* renderer,
+                       const SDL_FRect& pictureRect) const;
+
+  /// @brief Hand what the canvas drew to the scratch or the buffer history
+  void collectDirty();
+
+  /// @brief Redraw rect of the scratch on the overlay, on the next update
+  void invalidateOverlay(const SDL_Rect& rect)
+  {
+    if (SDL_RectEmpty(&rect)) return;
+    overlay.invalidate(rect);
+    changed = true;
+  }
 };
 
 } // namespace pixedit
@@ -0,0 +1,206 @@
+#include "PixJournal.hpp"
+#include <algorithm>
+#include <filesystem>
+#include "utils/PixFormat.hpp"
+#include "utils/PixReader.hpp"
+#include "utils/PixWriter.hpp"
+
+namespace pixedit {
+
+namespace {
+
+constexpr Uint16 CHECKPOINT_CURRENT = 0x1;
+constexpr Uint16 CHECKPOINT_SYNCED = 0x2;
+
+bool
+writeCheckpoint(SDL_RWops* rw, bool current)
+{
+  Uint16 flags = current ? CHECKPOINT_CURRENT | CHECKPOINT_SYNCED : 0;
+  return SDL_WriteLE32(rw, makeTag("CHKP")) && SDL_WriteLE32(rw, 2) &&
+         SDL_WriteLE16(rw, flags);
+}
+
+bool
+writeDelta(SDL_RWops* rw, History& history, size_t index)
+{
+  auto startPos = SDL_RWtell(rw);
+  if (!SDL_WriteLE32(rw, makeTag("DELT")) || !SDL_WriteLE32(rw, 0)) {
+    return false;
+  }
+  if (!history.writeStep(index, rw)) return false;
+  auto endPos = SDL_RWtell(rw);
+  Uint32 size = Uint32(endPos - startPos - 8);
+  SDL_RWseek(rw, startPos + 4, RW_SEEK_SET);
+  bool ok = SDL_WriteLE32(rw, size);
+  SDL_RWseek(rw, endPos, RW_SEEK_SET);
+  if (size % 2) ok = ok && SDL_WriteU8(rw, 0);
+  return ok;
+}
+
+} // namespace
+
+bool
+PixJournal::save(const std::string& filename, History& history)
+{
+  history.flush();
+  size_t count = history.size();
+  size_t current = history.getPosition();
+
+  // Only steps not changing geometry around the current point can go on it
+  size_t first = current;
+  while (first > 0 && !history.changesGeometry(first - 1)) --first;
+  size_t last = current;
+  while (last < count && !history.changesGeometry(last)) ++last;
+
+  auto base = first == 0 ? history.getBaseId() : history.getStepId(first - 1);
+  bool canAppend = !this->filename.empty() && filename == this->filename &&
+                   base == baseId && stepIds.size() <= last - first;
+  for (size_t i = 0; canAppend && i < stepIds.size(); ++i) {
+    canAppend = stepIds[i] == history.getStepId(first + i);
+  }
+  // CHKP can not move back, so current must be a new step or stay the same
+  canAppend = canAppend && (current - first > stepIds.size() ||
+                            current - first == position);
+  if (canAppend && append(history, first, last)) return true;
+  return rewrite(filename, history, first, last);
+}
+
+bool
+PixJournal::append(History& history, size_t first, size_t last)
+{
+  size_t current = history.getPosition();
+  size_t begin = first + stepIds.size();
+  if (begin == last) return true;
+  SDL_RWops* rw = SDL_RWFromFile(filename.c_str(), "r+b");
+  if (!rw) return false;
+  SDL_RWseek(rw, 4, RW_SEEK_SET);
+  Sint64 riffEnd = 8 + Sint64(SDL_ReadLE32(rw));
+  SDL_RWseek(rw, riffEnd, RW_SEEK_SET);
+  bool ok = SDL_RWtell(rw) == riffEnd &&
+            writeSteps(rw, history, begin, last, current);
+  ok = SDL_RWclose(rw) == 0 && ok;
+  if (!ok) return false;
+  for (size_t i = begin; i < last; ++i) {
+    stepIds.push_back(history.getStepId(i));
+  }
+  position = current - first;
+  return true;
+}
+
+bool
+PixJournal::rewrite(const std::string& filename,
+                    History& history,
+                    size_t first,
+                    size_t last)
+{
+  size_t current = history.getPosition();
+  auto base = history.getStateAt(first);
+  if (!base) return false;
+  auto tempFilename = filename + ".tmp";
+  SDL_RWops* rw = SDL_RWFromFile(tempFilename.c_str(), "wb");
+  if (!rw) return false;
+  bool ok = writePixImage(rw, base.get()) > 0 &&
+            writeCheckpoint(rw, current == first) &&
+            writeSteps(rw, history, first, last, current);
+  ok = SDL_RWclose(rw) == 0 && ok;
+  std::error_code ec;
+  if (ok) std::filesystem::rename(tempFilename, filename, ec);
+  if (!ok || ec) {
+    std::filesystem::remove(tempFilename, ec);
+    return false;
+  }
+  this->filename = filename;
+  baseId = first == 0 ? history.getBaseId() : history.getStepId(first - 1);
+  stepIds.clear();
+  for (size_t i = first; i < last; ++i) {
+    stepIds.push_back(history.getStepId(i));
+  }
+  position = current - first;
+  return true;
+}
+
+bool
+PixJournal::writeSteps(SDL_RWops* rw,
+                       History& history,
+                       size_t begin,
+                       size_t end,
+                       size_t current)
+{
+  for (size_t i = begin; i < end; ++i) {
+    if (!writeDelta(rw, history, i)) return false;
+    if (!writeCheckpoint(rw, current == i + 1)) return false;
+  }
+  // Only now the new chunks become visible
+  auto riffEnd = SDL_RWtell(rw);
+  SDL_RWseek(rw, 4, RW_SEEK_SET);
+  return SDL_WriteLE32(rw, Uint32(riffEnd - 8));
+}
+
+bool
+PixJournal::load(const std::string& filename,
+                 History& history,
+                 Surface& surface)
+{
+  SDL_RWops* rw = SDL_RWFromFile(filename.c_str(), "rb");
+  if (!rw) return false;
+  Surface base{readPixImage(rw), true};
+  if (!base) {
+    SDL_RWclose(rw);
+    return false;
+  }
+  SDL_RWseek(rw, 4, RW_SEEK_SET);
+  Sint64 riffEnd = std::min(8 + Sint64(SDL_ReadLE32(rw)), SDL_RWsize(rw));
+  history.reset(base);
+  size_t steps = 0;
+  size_t current = 0;
+  bool hasCheckpoint = false;
+  bool complete = true;
+  Sint64 pos = 12;
+  while (pos + 8 <= riffEnd) {
+    SDL_RWseek(rw, pos, RW_SEEK_SET);
+    Uint32 tag = SDL_ReadLE32(rw);
+    Uint32 size = SDL_ReadLE32(rw);
+    if (pos + 8 + size > riffEnd) break;
+    if (tag == makeTag("DELT")) {
+      if (!history.appendStep(rw, size)) {
+        complete = false;
+        break;
+      }
+      ++steps;
+    } else if (tag == makeTag("CHKP") && size >= 2) {
+      hasCheckpoint = true;
+      if (SDL_ReadLE16(rw) & CHECKPOINT_CURRENT) current = steps;
+    }
+    pos += 8 + size + size % 2;
+  }
+  SDL_RWclose(rw);
+
+  // The budget might not fit them all
+  if (history.size() < steps) {
+    steps = history.size();
+    current = std::min(current, steps);
+    complete = false;
+  }
+  surface = base.clone();
+  for (size_t i = 0; i < current; ++i) history.redo(surface);
+
+  // A file we could not fully understand is rewritten on the next save
+  this->filename = hasCheckpoint && complete ? filename : std::string{};
+  baseId = history.getBaseId();
+  stepIds.clear();
+  for (size_t i = 0; i < steps; ++i) stepIds.push_back(history.getStepId(i));
+  position = current;
+  return true;
+}
+
+Surface
+loadPixJournalSurface(const std::string& filename)
+{
+  History history;
+  Surface surface;
+  PixJournal journal;
+  if (!journal.load(filename, history, surface)) return nullptr;
+  return surface;
+}
+
+} // namespace pixedit
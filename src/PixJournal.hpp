@@ -0,0 +1,73 @@
+#ifndef PIXEDIT_SRC_PIX_JOURNAL_INCLUDED
+#define PIXEDIT_SRC_PIX_JOURNAL_INCLUDED
+
+#include <string>
+#include <vector>
+#include "History.hpp"
+#include "Surface.hpp"
+
+namespace pixedit {
+
+/**
+ * Keeps the undo history of a picture inside its .pix file
+ *
+ * The file starts as a regular .pix, whose DATA is the oldest state kept. It
+ * is followed by a DELT chunk for each step, holding its tile deltas as the
+ * History stores them, and a CHKP chunk after each DELT marking the state it
+ * leads to. The last CHKP flagged as current tells which state is open.
+ *
+ * Saving after more steps were committed only appends their chunks and then
+ * patches the RIFF size. If the process dies in the middle the old size is
+ * still there, so readers ignore the partial chunks. When the history no
+ * longer matches what is on the file (an undo followed by new edits, a step
+ * changing geometry, old steps dropped by the budget) the whole file is
+ * written to a temp file that then replaces it.
+ */
+class PixJournal
+{
+  std::string filename;
+  History::StateId baseId = 0;
+  std::vector<History::StateId> stepIds;
+  size_t position = 0;
+
+public:
+  /// @brief Save history to filename, appending to it if possible
+  bool save(const std::string& filename, History& history);
+
+  /**
+   * Load history and the current state from filename
+   *
+   * Steps are read as stored, nothing is encoded again.
+   * @return false if it is not a valid .pix file.
+   */
+  bool load(const std::string& filename, History& history, Surface& surface);
+
+  /// @brief The file it is in sync with, empty if none
+  const std::string& getFilename() const { return filename; }
+
+  /// @brief The number of steps on the file
+  size_t size() const { return stepIds.size(); }
+
+private:
+  bool append(History& history, size_t first, size_t last);
+
+  bool rewrite(const std::string& filename,
+               History& history,
+               size_t first,
+               size_t last);
+
+  /// @brief Write DELT and CHKP chunks for steps in [begin, end) at rw end
+  bool writeSteps(SDL_RWops* rw,
+                  History& history,
+                  size_t begin,
+                  size_t end,
+                  size_t current);
+};
+
+/// @brief Load just the current state of a .pix file, journal or not
+Surface
+loadPixJournalSurface(const std::string& filename);
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_PIX_JOURNAL_INCLUDED */
@@ -0,0 +1,66 @@
+#include "Stamp.hpp"
+#include "Pen.hpp"
+#include "utils/blendRow.hpp"
+
+namespace pixedit {
+
+Pen::Pen(const Stamp& stamp)
+  : type(STAMP)
+  , w(stamp.getW())
+  , h(stamp.getH())
+  , stamp(&stamp)
+{
+  assert(w > 0 && h > 0);
+}
+
+Stamp::Stamp(Surface source)
+  : source(source)
+{
+  const int w = getW(), h = getH();
+  auto format = source.getFormat();
+  auto key = source.getColorKey();
+  rowStart.reserve(h + 1);
+  rowStart.push_back(0);
+  for (int y = 0; y < h; ++y) {
+    int begin = -1;
+    for (int x = 0; x <= w; ++x) {
+      bool opaque = false;
+      if (x < w) {
+        Uint32 raw = source.getPixel(x, y);
+        opaque = !(key && raw == *key) &&
+                 !(format->Amask && (raw & format->Amask) == 0);
+      }
+      if (opaque && begin < 0) {
+        begin = x;
+      } else if (!opaque && begin >= 0) {
+        runs.push_back({begin, x - begin});
+        begin = -1;
+      }
+    }
+    rowStart.push_back(runs.size());
+  }
+}
+
+Surface
+Stamp::getPixels(const SDL_PixelFormat* format) const
+{
+  auto current = converted.getFormat();
+  if (current && current->format == format->format &&
+      current->palette == format->palette) {
+    return converted;
+  }
+  converted = source.cloneWith(format);
+  if (!format->Amask) {
+    if (int shift = alphaShiftOf(format); shift >= 0) {
+      for (int y = 0; y < getH(); ++y) {
+        for (int x = 0; x < getW(); ++x) {
+          converted.setPixel(
+            x, y, converted.getPixel(x, y) | Uint32(0xFF) << shift);
+        }
+      }
+    }
+  }
+  return converted;
+}
+
+} // namespace pixedit
@@ -0,0 +1,62 @@
+#ifndef PIXEDIT_SRC_STAMP_INCLUDED
+#define PIXEDIT_SRC_STAMP_INCLUDED
+
+#include <span>
+#include <vector>
+#include <SDL.h>
+#include "Surface.hpp"
+
+namespace pixedit {
+
+/**
+ * A picture to paint with, as the tip of a Pen
+ *
+ * The opaque pixels of each row are found once, when created, and kept as
+ * runs, so putting the stamp is a copy per run instead of a test per pixel.
+ * A pixel is transparent if it has the color key of the source or, when the
+ * source has alpha, if its alpha is 0.
+ */
+class Stamp
+{
+public:
+  /// @brief The opaque pixels [x, x + len) of a row
+  struct Run
+  {
+    int x;
+    int len;
+  };
+
+private:
+  Surface source;
+  std::vector<Run> runs;
+  std::vector<int> rowStart;
+  mutable Surface converted;
+
+public:
+  /// @brief Create from the pixels of source, which must not change after
+  explicit Stamp(Surface source);
+
+  constexpr int getW() const { return source.getW(); }
+  constexpr int getH() const { return source.getH(); }
+
+  Surface getSource() const { return source; }
+
+  /// @brief The opaque runs of row y, left to right
+  std::span<const Run> getRuns(int y) const
+  {
+    return {runs.data() + rowStart[y], runs.data() + rowStart[y + 1]};
+  }
+
+  /**
+   * The pixels of the stamp in format
+   *
+   * The conversion is kept until another format is asked for. Formats
+   * without alpha get their unused byte opaque, if any, so the stamp can
+   * also be blended.
+   */
+  Surface getPixels(const SDL_PixelFormat* format) const;
+};
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_STAMP_INCLUDED */
@@ -0,0 +1,71 @@
+#include "TiledTexture.hpp"
+
+namespace pixedit {
+
+bool
+TiledTexture::resize(int w, int h)
+{
+  if (w == this->w && h == this->h) return false;
+  reset();
+  this->w = w;
+  this->h = h;
+  cols = (w + TILE_SIZE - 1) / TILE_SIZE;
+  rows = (h + TILE_SIZE - 1) / TILE_SIZE;
+  tiles.resize(cols * rows);
+  return true;
+}
+
+void
+TiledTexture::reset()
+{
+  for (auto& tile : tiles) SDL_DestroyTexture(tile.texture);
+  tiles.clear();
+  w = h = cols = rows = 0;
+}
+
+void
+TiledTexture::invalidate(const SDL_Rect& rect)
+{
+  forEachTile(rect, [&](int index, const SDL_Rect& tileRect) {
+    auto& dirty = tiles[index].dirty;
+    SDL_Rect part;
+    SDL_IntersectRect(&rect, &tileRect, &part);
+    if (SDL_RectEmpty(&dirty)) {
+      dirty = part;
+    } else {
+      SDL_UnionRect(&dirty, &part, &dirty);
+    }
+  });
+}
+
+void
+TiledTexture::render(SDL_Renderer* renderer,
+                     const SDL_FRect& dstRect,
+                     const SDL_Rect& visible) const
+{
+  if (w == 0 || h == 0) return;
+  float scaleX = dstRect.w / w;
+  float scaleY = dstRect.h / h;
+  forEachTile(visible, [&](int index, const SDL_Rect& tileRect) {
+    auto texture = tiles[index].texture;
+    if (!texture) return;
+    SDL_FRect rect{
+      dstRect.x + tileRect.x * scaleX,
+      dstRect.y + tileRect.y * scaleY,
+      tileRect.w * scaleX,
+      tileRect.h * scaleY,
+    };
+    SDL_RenderCopyF(renderer, texture, nullptr, &rect);
+  });
+}
+
+SDL_Texture*
+TiledTexture::createTile(SDL_Renderer* renderer, int w, int h)
+{
+  auto texture = SDL_CreateTexture(
+    renderer, SDL_PIXELFORMAT_ABGR32, SDL_TEXTUREACCESS_STREAMING, w, h);
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  return texture;
+}
+
+} // namespace pixedit
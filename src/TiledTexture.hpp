@@ -0,0 +1,134 @@
+#ifndef PIXEDIT_SRC_TILED_TEXTURE_INCLUDED
+#define PIXEDIT_SRC_TILED_TEXTURE_INCLUDED
+
+#include <algorithm>
+#include <concepts>
+#include <vector>
+#include <SDL.h>
+#include "Surface.hpp"
+
+namespace pixedit {
+
+/**
+ * A picture sized streaming texture, split in tiles of TILE_SIZE
+ *
+ * No single texture has to fit the whole picture, so pictures larger than
+ * the renderer max texture size can be shown. A tile texture is only
+ * created when a dirty region of it gets updated while visible, and only
+ * the dirty part of each tile is uploaded. A tile never updated has no
+ * texture and is not drawn.
+ */
+class TiledTexture
+{
+public:
+  static constexpr int TILE_SIZE = 512;
+
+private:
+  struct Tile
+  {
+    SDL_Texture* texture = nullptr;
+    SDL_Rect dirty{0, 0, 0, 0}; ///< In picture coordinates
+  };
+
+  int w = 0;
+  int h = 0;
+  int cols = 0;
+  int rows = 0;
+  std::vector<Tile> tiles;
+
+public:
+  TiledTexture() = default;
+  TiledTexture(const TiledTexture&) = delete;
+  TiledTexture& operator=(const TiledTexture&) = delete;
+  ~TiledTexture() { reset(); }
+
+  constexpr int getW() const { return w; }
+  constexpr int getH() const { return h; }
+
+  /**
+   * Make it cover a w x h picture
+   *
+   * @return true if the size changed, in which case all tiles were dropped
+   */
+  bool resize(int w, int h);
+
+  /// @brief Drop all tiles
+  void reset();
+
+  /// @brief Mark rect as changed, to upload on the next update()
+  void invalidate(const SDL_Rect& rect);
+
+  /// @brief Mark it all as changed
+  void invalidate() { invalidate({0, 0, w, h}); }
+
+  /**
+   * Upload the dirty regions of the tiles crossing visible
+   *
+   * For each, upload(surface, rect) is called with surface locked over the
+   * rect region of the picture, to be filled with its pixels in
+   * SDL_PIXELFORMAT_ABGR32. Tiles out of visible stay dirty until seen.
+   */
+  template<std::invocable<Surface&, const SDL_Rect&> UPLOAD>
+  void update(SDL_Renderer* renderer, const SDL_Rect& visible, UPLOAD upload)
+  {
+    forEachTile(visible, [&](int index, const SDL_Rect& tileRect) {
+      auto& tile = tiles[index];
+      if (SDL_RectEmpty(&tile.dirty)) return;
+      if (!tile.texture) {
+        tile.texture = createTile(renderer, tileRect.w, tileRect.h);
+        if (!tile.texture) return;
+        tile.dirty = tileRect;
+      }
+      SDL_Rect lockRect{tile.dirty.x - tileRect.x,
+                        tile.dirty.y - tileRect.y,
+                        tile.dirty.w,
+                        tile.dirty.h};
+      Surface surface;
+      {
+        SDL_Surface* temp;
+        SDL_LockTextureToSurface(tile.texture, &lockRect, &temp);
+        surface = Surface{temp, false};
+      }
+      upload(surface, tile.dirty);
+      SDL_UnlockTexture(tile.texture);
+      tile.dirty = {0, 0, 0, 0};
+    });
+  }
+
+  /**
+   * Draw the tiles crossing visible
+   *
+   * @param dstRect where the whole picture goes on the renderer
+   * @param visible the region of the picture to draw
+   */
+  void render(SDL_Renderer* renderer,
+              const SDL_FRect& dstRect,
+              const SDL_Rect& visible) const;
+
+private:
+  static SDL_Texture* createTile(SDL_Renderer* renderer, int w, int h);
+
+  /// @brief Call callback(index, tileRect) for each tile crossing rect
+  template<std::invocable<int, const SDL_Rect&> CALLBACK>
+  void forEachTile(const SDL_Rect& rect, CALLBACK callback) const
+  {
+    SDL_Rect bounds{0, 0, w, h};
+    SDL_Rect r;
+    if (!SDL_IntersectRect(&rect, &bounds, &r)) return;
+    int colEnd = (r.x + r.w - 1) / TILE_SIZE + 1;
+    int rowEnd = (r.y + r.h - 1) / TILE_SIZE + 1;
+    for (int row = r.y / TILE_SIZE; row < rowEnd; ++row) {
+      for (int col = r.x / TILE_SIZE; col < colEnd; ++col) {
+        SDL_Rect tileRect{col * TILE_SIZE,
+                          row * TILE_SIZE,
+                          std::min(TILE_SIZE, w - col * TILE_SIZE),
+                          std::min(TILE_SIZE, h - row * TILE_SIZE)};
+        callback(row * cols + col, tileRect);
+      }
+    }
+  }
+};
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_TILED_TEXTURE_INCLUDED */
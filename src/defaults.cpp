@@ -1,11 +1,17 @@
 #include "defaults.hpp"
+#include <cstddef>
 
 namespace pixedit::defaults {
 
 extern const int WINDOW_WIDTH = PIXEDIT_WINDOW_WIDTH;
 extern const int WINDOW_HEIGHT = PIXEDIT_WINDOW_HEIGHT;
 extern const bool WINDOW_MAXIMIZED = PIXEDIT_WINDOW_MAXIMIZED;
-extern const unsigned HISTORY_MAX = PIXEDIT_HISTORY_MAX;
+extern const size_t HISTORY_MEMORY_BUDGET = PIXEDIT_HISTORY_MEMORY_BUDGET;
+extern const size_t HISTORY_DISK_BUDGET = PIXEDIT_HISTORY_DISK_BUDGET;
+extern const size_t COMMAND_LOG_KEYFRAME_INTERVAL =
+  PIXEDIT_COMMAND_LOG_KEYFRAME_INTERVAL;
+extern const unsigned PARALLEL_FILL_THREADS = PIXEDIT_PARALLEL_FILL_THREADS;
+extern const size_t PARALLEL_FILL_CUTOFF = PIXEDIT_PARALLEL_FILL_CUTOFF;
 
 namespace clipboards {
 extern const int FALLBACK = CLIPBOARD_FALLBACK;
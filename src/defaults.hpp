@@ -19,10 +19,31 @@
 #define PIXEDIT_WINDOW_MAXIMIZED 0
 #endif // PIXEDIT_WINDOW_MAXIMIZED
 
-// The max history size
-#ifndef PIXEDIT_HISTORY_MAX
-#define PIXEDIT_HISTORY_MAX 30
-#endif // PIXEDIT_HISTORY_MAX
+// The max bytes each picture history keeps in RAM, before spilling to disk
+#ifndef PIXEDIT_HISTORY_MEMORY_BUDGET
+#define PIXEDIT_HISTORY_MEMORY_BUDGET (64 << 20)
+#endif // PIXEDIT_HISTORY_MEMORY_BUDGET
+
+// The max bytes each picture history keeps on disk, before dropping entries
+#ifndef PIXEDIT_HISTORY_DISK_BUDGET
+#define PIXEDIT_HISTORY_DISK_BUDGET (512 << 20)
+#endif // PIXEDIT_HISTORY_DISK_BUDGET
+
+// How many command log steps between full keyframes
+#ifndef PIXEDIT_COMMAND_LOG_KEYFRAME_INTERVAL
+#define PIXEDIT_COMMAND_LOG_KEYFRAME_INTERVAL 32
+#endif // PIXEDIT_COMMAND_LOG_KEYFRAME_INTERVAL
+
+// How many bands large fills are split in, to paint in parallel. 0 is one
+// per core and 1 disables it
+#ifndef PIXEDIT_PARALLEL_FILL_THREADS
+#define PIXEDIT_PARALLEL_FILL_THREADS 0
+#endif // PIXEDIT_PARALLEL_FILL_THREADS
+
+// The min pixels a fill must cover to be split in bands
+#ifndef PIXEDIT_PARALLEL_FILL_CUTOFF
+#define PIXEDIT_PARALLEL_FILL_CUTOFF (512 * 512)
+#endif // PIXEDIT_PARALLEL_FILL_CUTOFF
 
 #define CLIPBOARD_FALLBACK 0
 #define CLIPBOARD_XCLIP 1
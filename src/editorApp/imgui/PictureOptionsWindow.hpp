@@ -42,6 +42,18 @@ PatternCombo(const char* label, Pattern* pattern)
   return result;
 }
 
+inline bool
+BlendModeCombo(const char* label, BlendMode* mode)
+{
+  static const char* names[] = {"Replace", "Over", "Multiply", "Add"};
+  int current = int(*mode);
+  if (ImGui::Combo(label, &current, names, IM_ARRAYSIZE(names))) {
+    *mode = BlendMode(current);
+    return true;
+  }
+  return false;
+}
+
 void
 pictureOptionsAuxWindow()
 {
@@ -104,6 +116,23 @@ pictureOptionsAuxWindow()
       picture.setBrush(brush);
       pushAction(actions::EDITOR_FOCUS_PICTURE);
     }
+    BlendMode blendMode = brush.blendMode;
+    if (BlendModeCombo("Blend: ", &blendMode)) {
+      brush.blendMode = blendMode;
+      picture.setBrush(brush);
+      pushAction(actions::EDITOR_FOCUS_PICTURE);
+    }
+    if (ImGui::CollapsingHeader("Flood fill")) {
+      auto& view = currentView();
+      ImGui::SliderInt("Tolerance", &view.fillTolerance, 0, 255);
+      if (ImGui::RadioButton("Contiguous", view.fillContiguous)) {
+        view.fillContiguous = true;
+      }
+      ImGui::SameLine();
+      if (ImGui::RadioButton("All of the color", !view.fillContiguous)) {
+        view.fillContiguous = false;
+      }
+    }
     if (ImGui::CollapsingHeader("Selection", ImGuiTreeNodeFlags_DefaultOpen)) {
       bool transparent = picture.isTransparent();
       if (ImGui::Checkbox("Transparent", &transparent)) {
@@ -113,6 +142,34 @@ pictureOptionsAuxWindow()
       ImGui::Checkbox("Fill selected out region",
                       &currentView().fillSelectedOut);
     }
+    auto& buffer = currentView().getBuffer();
+    if (buffer && ImGui::CollapsingHeader("History")) {
+      constexpr double MIB = 1024 * 1024;
+      auto stats = buffer->getHistoryStats();
+      ImGui::Text("In RAM: %zu steps, %.2f MiB",
+                  stats.entriesInRam,
+                  stats.bytesInRam / MIB);
+      ImGui::Text("On disk: %zu steps, %.2f MiB",
+                  stats.entriesOnDisk,
+                  stats.bytesOnDisk / MIB);
+      ImGui::Text("Disk hits: %zu (last %.2fms, total %.2fms)",
+                  stats.diskHits,
+                  stats.lastHitMs,
+                  stats.totalHitMs);
+      bool logEnabled = buffer->getCommandLog() != nullptr;
+      if (ImGui::Checkbox("Record input instead of pixels", &logEnabled)) {
+        buffer->enableCommandLog(logEnabled);
+      }
+      if (auto log = buffer->getCommandLog()) {
+        ImGui::Text("Command log: %zu steps, %.2f MiB",
+                    log->size(),
+                    log->getBytes() / MIB);
+      }
+      bool journalEnabled = buffer->hasJournal();
+      if (ImGui::Checkbox("Keep history in .pix file", &journalEnabled)) {
+        buffer->enableJournal(journalEnabled);
+      }
+    }
   }
   ImGui::End();
 }
@@ -4,8 +4,8 @@
 #include <vector>
 #include <SDL_image.h>
 #include "PictureBuffer.hpp"
+#include "PixJournal.hpp"
 #include "Surface.hpp"
-#include "utils/PixReader.hpp"
 #include "utils/replayPicture.hpp"
 
 namespace pixedit {
@@ -20,12 +20,7 @@ getDefaultLoaderIds()
 static Surface
 doLoadSurface(const std::string& filename, Id loader)
 {
-  if (loader == loaders::PIX) {
-    SDL_RWops* rw = SDL_RWFromFile(filename.c_str(), "rb");
-    Surface s{readPixImage(rw), true};
-    SDL_RWclose(rw);
-    return s;
-  }
+  if (loader == loaders::PIX) return loadPixJournalSurface(filename);
   if (loader == loaders::SDL2_IMAGE) {
     return {IMG_Load(filename.c_str()), true};
   }
@@ -45,7 +40,15 @@ doLoadSurface(const std::string& filename, Id loader)
       PictureFile{filename, loadBuffer_##id, nullptr}, s, false);              \
   }
 
-makeLoaderWrapper(PIX);
+static std::unique_ptr<PictureBuffer>
+loadBuffer_PIX(const std::string& filename)
+{
+  auto buffer = std::make_unique<PictureBuffer>(
+    PictureFile{filename, loadBuffer_PIX, nullptr}, nullptr, false);
+  if (!buffer->loadJournal(filename)) { return nullptr; }
+  return buffer;
+}
+
 makeLoaderWrapper(SDL2_IMAGE);
 makeLoaderWrapper(TEXT);
 
@@ -59,11 +62,8 @@ loadBuffer(const std::string& filename, Id loader)
   };
   if (loader.empty()) {
     for (Id id : getDefaultLoaderIds()) {
-      auto s = doLoadSurface(filename, id);
-      if (s) {
-        return std::make_unique<PictureBuffer>(
-          PictureFile{filename, loaders[id], nullptr}, std::move(s));
-      }
+      auto buffer = loaders[id](filename);
+      if (buffer) { return buffer; }
     }
     return nullptr;
   }
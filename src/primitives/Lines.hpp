@@ -4,7 +4,9 @@
 #include <span>
 #include "Canvas.hpp"
 #include "Line.hpp"
+#include "PenStroke.hpp"
 #include "Point.hpp"
+#include "utils/rasterLine.hpp"
 
 namespace pixedit {
 
@@ -20,19 +22,33 @@ struct Lines
   }
 };
 
+/// @brief Add the segments between vertices to stroke, without the last point
+inline void
+addOpenLines(PenStroke& stroke, std::span<const SDL_Point> vertices)
+{
+  for (size_t i = 1; i < vertices.size(); ++i) {
+    auto& p1 = vertices[i - 1];
+    auto& p2 = vertices[i];
+    stroke.addOpenLine(p1.x, p1.y, p2.x, p2.y);
+  }
+}
+
 inline Canvas&
 operator|(Canvas& c, OpenLines lns)
 {
-  for (auto it = lns.begin() + 1; it != lns.end(); ++it) {
-    c | OpenLineTo(*(it - 1), *it);
-  }
-  return c;
+  PenStroke stroke{c.getBrush().pen, c.getPenClipRect()};
+  addOpenLines(stroke, lns);
+  return c | stroke;
 }
 
 inline Canvas&
 operator|(Canvas& c, Lines lns)
 {
-  return c | lns.vertices | lns.vertices.back();
+  if (lns.vertices.empty()) return c;
+  PenStroke stroke{c.getBrush().pen, c.getPenClipRect()};
+  addOpenLines(stroke, lns.vertices);
+  stroke.add(lns.vertices.back().x, lns.vertices.back().y);
+  return c | stroke;
 }
 
 } // namespace pixedit
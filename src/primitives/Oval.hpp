@@ -1,8 +1,11 @@
 #ifndef PIXEDIT_SRC_PRIMITIVES_OVAL_INCLUDED
 #define PIXEDIT_SRC_PRIMITIVES_OVAL_INCLUDED
 
+#include <algorithm>
+#include <vector>
 #include "Canvas.hpp"
 #include "Line.hpp"
+#include "PenStroke.hpp"
 #include "Point.hpp"
 #include "utils/rasterOval.hpp"
 
@@ -114,18 +117,31 @@ OutlineOvalTo(SDL_Point p1, SDL_Point p2)
 inline Canvas&
 operator|(Canvas& c, FillOval oval)
 {
+  auto clip = c.getPenClipRect();
+  // The raster can go a pixel past the rect on thin ovals
+  SDL_Rect bounds{oval.x - 1, oval.y - 1, oval.w + 2, oval.h + 2};
+  if (!SDL_HasIntersection(&bounds, &clip)) return c;
+  std::vector<HorizontalLine> lines;
   rasterOval(oval.x, oval.y, oval.w, oval.h, [&](int x, int y, int d) {
-    c | HorizontalLine{x, y, d + 1};
+    if (y < clip.y || y >= clip.y + clip.h) return;
+    int x1 = std::min(x + d + 1, clip.x + clip.w);
+    x = std::max(x, clip.x);
+    if (x < x1) lines.push_back({x, y, x1 - x});
   });
-  return c;
+  return c | HorizontalLines{lines};
 }
 
 inline Canvas&
 operator|(Canvas& c, OutlineOval oval)
 {
-  rasterOvalOutline(
-    oval.x, oval.y, oval.w, oval.h, [&](int x, int y) { c | Point(x, y); });
-  return c;
+  PenStroke stroke{c.getBrush().pen, c.getPenClipRect()};
+  // The raster can go a pixel past the rect on thin ovals
+  SDL_Rect bounds{oval.x - 1, oval.y - 1, oval.w + 2, oval.h + 2};
+  if (!SDL_HasIntersection(&bounds, &stroke.getClip())) return c;
+  rasterOvalOutline(oval.x, oval.y, oval.w, oval.h, [&](int x, int y) {
+    stroke.add(x, y);
+  });
+  return c | stroke;
 }
 
 } // namespace pixedit
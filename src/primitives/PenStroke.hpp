@@ -0,0 +1,192 @@
+#ifndef PIXEDIT_SRC_PRIMITIVES_PEN_STROKE_INCLUDED
+#define PIXEDIT_SRC_PRIMITIVES_PEN_STROKE_INCLUDED
+
+#include <algorithm>
+#include <concepts>
+#include <vector>
+#include <SDL.h>
+#include "Canvas.hpp"
+#include "Pen.hpp"
+#include "utils/rasterLine.hpp"
+
+namespace pixedit {
+
+/**
+ * The area swept by a pen moved along a path
+ *
+ * Add the positions of the pen center, as given by the rasterizers, then
+ * draw it on a Canvas. The boxes of the pen are merged into one span per
+ * row and distinct piece, so every pixel is written once no matter how
+ * thick the pen is or how often the path crosses itself.
+ */
+class PenStroke
+{
+  struct Run
+  {
+    int y;
+    int x0;
+    int x1; ///< One past the last pixel
+  };
+
+  Pen pen;
+  SDL_Rect clip;
+  std::vector<Run> centers;
+
+public:
+  /// @param pen the pen to sweep
+  /// @param clip centers outside are dropped, see Canvas::getPenClipRect()
+  explicit PenStroke(const Pen& pen, const SDL_Rect& clip = NO_CLIP)
+    : pen(pen)
+    , clip(clip)
+  {
+  }
+
+  constexpr const Pen& getPen() const { return pen; }
+
+  /// @brief Where centers are kept, to skip the rest of a path up front
+  constexpr const SDL_Rect& getClip() const { return clip; }
+
+  bool empty() const { return centers.empty(); }
+
+  /// @brief Add the pen centered at (x, y)
+  void add(int x, int y) { addRun(x, y, 1); }
+
+  /// @brief Add the pen centered at each of the len pixels from (x, y)
+  void addRun(int x, int y, int len)
+  {
+    if (y < clip.y || y >= clip.y + clip.h) return;
+    int x1 = std::min(x + len, clip.x + clip.w);
+    x = std::max(x, clip.x);
+    len = x1 - x;
+    if (len <= 0) return;
+    // Lines and ovals give neighbors in a row one after the other
+    if (!centers.empty()) {
+      auto& last = centers.back();
+      if (last.y == y && x <= last.x1 && x + len >= last.x0) {
+        last.x0 = std::min(last.x0, x);
+        last.x1 = std::max(last.x1, x + len);
+        return;
+      }
+    }
+    centers.push_back({y, x, x + len});
+  }
+
+  /// @brief Add the pen along the half open line, see rasterLineOpen()
+  void addOpenLine(int xBeg, int yBeg, int xEnd, int yEnd)
+  {
+    // Rows of vertical runs are added in the line direction too
+    const bool up = yEnd < yBeg;
+    rasterLineOpenRuns(
+      xBeg, yBeg, xEnd, yEnd, clip, [&](int x, int y, int w, int h) {
+        for (int i = 0; i < h; ++i) addRun(x, up ? y + h - 1 - i : y + i, w);
+      });
+  }
+
+  /**
+   * Call callback(x, y, len) for each run of centers, in the order added
+   *
+   * Runs are not merged, so a center the path went through twice comes
+   * twice. This is for pens whose boxes can not be merged, as stamps.
+   */
+  template<std::invocable<int, int, int> CALLBACK>
+  void forEachCenter(CALLBACK callback) const
+  {
+    for (auto& c : centers) callback(c.x0, c.y, c.x1 - c.x0);
+  }
+
+  /**
+   * Call callback(x, y, len) once for each span covered by the pen
+   *
+   * Spans come sorted top to bottom then left to right, and never overlap or
+   * touch each other.
+   */
+  template<std::invocable<int, int, int> CALLBACK>
+  void forEachSpan(CALLBACK callback) const
+  {
+    if (centers.empty()) return;
+    const int offsetX = pen.w / 2 + pen.w % 2 - 1;
+    const int offsetY = pen.h / 2 + pen.h % 2 - 1;
+    auto [minIt, maxIt] = std::minmax_element(
+      centers.begin(), centers.end(), [](const Run& a, const Run& b) {
+        return a.y < b.y;
+      });
+    const int yMin = minIt->y;
+    const int rows = maxIt->y - yMin + 1;
+
+    // Bucket the runs by row, already as wide as the pen
+    std::vector<int> first(rows + 1, 0);
+    for (auto& c : centers) ++first[c.y - yMin + 1];
+    for (int i = 0; i < rows; ++i) first[i + 1] += first[i];
+    std::vector<Run> widened(centers.size());
+    std::vector<int> next(first.begin(), first.end() - 1);
+    for (auto& c : centers) {
+      widened[next[c.y - yMin]++] = {
+        c.y, c.x0 - offsetX, c.x1 - offsetX + pen.w - 1};
+    }
+    std::vector<int> count(rows);
+    for (int i = 0; i < rows; ++i) {
+      auto b = widened.begin() + first[i];
+      count[i] = mergeRuns(b, widened.begin() + first[i + 1]) - b;
+    }
+
+    // Rows whose single run touches the one of the next row chain together.
+    // The union over a chained window is one span, its min and max.
+    auto single = [&](int i) { return count[i] == 1; };
+    std::vector<int> breaks(rows, 0);
+    for (int i = 0; i + 1 < rows; ++i) {
+      const Run& a = widened[first[i]];
+      const Run& b = widened[first[i + 1]];
+      bool linked =
+        single(i) && single(i + 1) && b.x0 <= a.x1 && a.x0 <= b.x1;
+      breaks[i + 1] = breaks[i] + !linked;
+    }
+
+    std::vector<Run> window;
+    const int yEnd = yMin + rows - offsetY + pen.h - 1;
+    for (int y = yMin - offsetY; y < yEnd; ++y) {
+      int lo = std::max(0, y + offsetY - pen.h + 1 - yMin);
+      int hi = std::min(rows - 1, y + offsetY - yMin);
+      if (lo == hi ? single(lo) : breaks[hi] == breaks[lo]) {
+        Run span = widened[first[lo]];
+        for (int i = lo + 1; i <= hi; ++i) {
+          span.x0 = std::min(span.x0, widened[first[i]].x0);
+          span.x1 = std::max(span.x1, widened[first[i]].x1);
+        }
+        callback(span.x0, y, span.x1 - span.x0);
+        continue;
+      }
+      window.clear();
+      for (int i = lo; i <= hi; ++i) {
+        auto b = widened.begin() + first[i];
+        window.insert(window.end(), b, b + count[i]);
+      }
+      auto end = mergeRuns(window.begin(), window.end());
+      for (auto it = window.begin(); it != end; ++it) {
+        callback(it->x0, y, it->x1 - it->x0);
+      }
+    }
+  }
+
+private:
+  /// @brief Sort and join overlapping or touching runs, returning the new end
+  static std::vector<Run>::iterator mergeRuns(std::vector<Run>::iterator b,
+                                              std::vector<Run>::iterator e)
+  {
+    if (e - b < 2) return e;
+    std::sort(
+      b, e, [](const Run& l, const Run& r) { return l.x0 < r.x0; });
+    auto out = b;
+    for (auto it = b + 1; it != e; ++it) {
+      if (it->x0 <= out->x1) {
+        out->x1 = std::max(out->x1, it->x1);
+      } else {
+        *++out = *it;
+      }
+    }
+    return out + 1;
+  }
+};
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_PRIMITIVES_PEN_STROKE_INCLUDED */
@@ -1,9 +1,11 @@
 #ifndef PIXEDIT_SRC_PRIMITIVES_POLY_INCLUDED
 #define PIXEDIT_SRC_PRIMITIVES_POLY_INCLUDED
 
+#include <vector>
 #include "Canvas.hpp"
 #include "Line.hpp"
 #include "Lines.hpp"
+#include "PenStroke.hpp"
 #include "utils/rasterPoly.hpp"
 
 namespace pixedit {
@@ -17,8 +19,12 @@ inline Canvas&
 operator|(Canvas& c, OutlinePoly lns)
 {
   if (lns.vertices.size() < 3) { return c | static_cast<Lines>(lns); }
-  return c | lns.vertices |
-         OpenLineTo(lns.vertices.back(), lns.vertices.front());
+  PenStroke stroke{c.getBrush().pen, c.getPenClipRect()};
+  addOpenLines(stroke, lns.vertices);
+  auto& last = lns.vertices.back();
+  auto& first = lns.vertices.front();
+  stroke.addOpenLine(last.x, last.y, first.x, first.y);
+  return c | stroke;
 }
 
 struct FillPoly : Lines
@@ -30,10 +36,11 @@ inline Canvas&
 operator|(Canvas& c, FillPoly lns)
 {
   if (lns.vertices.size() < 3) { return c | static_cast<Lines>(lns); }
-  rasterPoly(lns.vertices, [&](int x, int y, int len) {
-    c | HorizontalLine{x, y, len};
+  std::vector<HorizontalLine> lines;
+  rasterPoly(lns.vertices, c.getPenClipRect(), [&](int x, int y, int len) {
+    lines.push_back({x, y, len});
   });
-  return c;
+  return c | HorizontalLines{lines};
 }
 
 } // namespace pixedit
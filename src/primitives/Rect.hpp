@@ -1,9 +1,11 @@
 #ifndef PIXEDIT_SRC_PRIMITIVES_RECT_INCLUDED
 #define PIXEDIT_SRC_PRIMITIVES_RECT_INCLUDED
 
+#include <algorithm>
 #include <SDL.h>
 #include "Canvas.hpp"
 #include "Line.hpp"
+#include "PenStroke.hpp"
 
 namespace pixedit {
 
@@ -116,8 +118,16 @@ operator|(Canvas& c, OutlineRect outline)
   int x1 = outline.x, y1 = outline.y;
   int w = outline.w, h = outline.h;
   int x2 = x1 + w - 1, y2 = y1 + h - 1;
-  return c | HorizontalLine{x1, y1, w} | HorizontalLine{x1, y2, w} |
-         VerticalLine{x1, y1 + 1, h - 2} | VerticalLine{x2, y1 + 1, h - 2};
+  PenStroke stroke{c.getBrush().pen, c.getPenClipRect()};
+  auto& clip = stroke.getClip();
+  stroke.addRun(x1, y1, w);
+  int yEnd = std::min(y2, clip.y + clip.h);
+  for (int y = std::max(y1 + 1, clip.y); y < yEnd; ++y) {
+    stroke.add(x1, y);
+    stroke.add(x2, y);
+  }
+  stroke.addRun(x1, y2, w);
+  return c | stroke;
 }
 
 } // namespace pixedit
@@ -1,38 +1,187 @@
 #ifndef PIXEDIT_SRC_TOOLS_FLOOD_FILL_TOOL_INCLUDED
 #define PIXEDIT_SRC_TOOLS_FLOOD_FILL_TOOL_INCLUDED
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include "PictureView.hpp"
-#include "utils/pixel.hpp"
+#include "utils/ColorMatcher.hpp"
+#include "utils/SurfaceView.hpp"
 
 namespace pixedit {
 
-inline void
-floodFill(Surface surface, const SDL_Point& p, RawColor color)
+/**
+ * Find where a run of pixels equal (or different if EQUAL is false) to value
+ * ends
+ *
+ * Pixels are compared in fixed size blocks, which the compiler can vectorize,
+ * and only the block where the run ends is looked at one by one.
+ * @return the first x in [x, end) not matching, or end.
+ */
+template<bool EQUAL, class PIXEL>
+inline int
+findRunEnd(const PIXEL* row, int x, int end, const PIXEL& value)
 {
-  const int WW = surface.getW();
-  const int HH = surface.getH();
-  if (p.x < 0 || p.y < 0 || p.x >= WW || p.y >= HH) { return; }
-
-  auto BPP = surface.getFormat()->BytesPerPixel;
-  auto prevColor = surface.getPixel(p.x, p.y);
-  if (prevColor == color) { return; }
-  std::vector<SDL_Point> stack{p};
+  constexpr int BLOCK = 16;
+  for (; x + BLOCK <= end; x += BLOCK) {
+    bool matches = true;
+    for (int i = 0; i < BLOCK; ++i) {
+      matches &= (row[x + i] == value) == EQUAL;
+    }
+    if (!matches) break;
+  }
+  while (x < end && (row[x] == value) == EQUAL) ++x;
+  return x;
+}
 
+/**
+ * Scanline fill over rows of cells
+ *
+ * Instead of single cells, it keeps a stack of spans to look at, each being a
+ * range of a row whose neighbor row was just filled. Every run of cells equal
+ * to value found inside a span is extended to its full length, filled at once
+ * and its rows above and below pushed as new spans.
+ *
+ * @param rowAt returns a pointer to the cells of row y
+ * @param fill is called with y, x0 and x1 for each run [x0, x1) found. It must
+ * change those cells to something not equal to value.
+ * @return the bounding box of filled cells
+ */
+template<class CELL,
+         std::invocable<int> ROW_AT,
+         std::invocable<int, int, int> FILL>
+inline SDL_Rect
+floodFillSpans(int WW,
+               int HH,
+               const SDL_Point& p,
+               const CELL& value,
+               ROW_AT rowAt,
+               FILL fill)
+{
+  struct Span
+  {
+    int y, x0, x1;
+  };
+  std::vector<Span> stack{{p.y, p.x, p.x + 1}};
+  int x0 = p.x, y0 = p.y, x1 = p.x, y1 = p.y;
   while (!stack.empty()) {
-    auto p = stack.back();
+    auto span = stack.back();
     stack.pop_back();
 
-    auto pixelPtr = surface.pixel(p.x, p.y);
-    auto c = getPixel(pixelPtr, BPP);
-    if (c != prevColor) continue;
-    setPixel(pixelPtr, color, BPP);
+    const CELL* row = rowAt(span.y);
+    int x = span.x0;
+    if (row[x] == value) {
+      while (x > 0 && row[x - 1] == value) --x;
+    } else {
+      x = findRunEnd<false>(row, x, span.x1, value);
+    }
+    while (x < span.x1) {
+      int runEnd = findRunEnd<true>(row, x, WW, value);
+      fill(span.y, x, runEnd);
+      x0 = std::min(x0, x);
+      x1 = std::max(x1, runEnd);
+      y0 = std::min(y0, span.y);
+      y1 = std::max(y1, span.y + 1);
+      if (span.y > 0) stack.push_back({span.y - 1, x, runEnd});
+      if (span.y < HH - 1) stack.push_back({span.y + 1, x, runEnd});
+      x = findRunEnd<false>(row, runEnd, span.x1, value);
+    }
+  }
+  return {x0, y0, x1 - x0, y1 - y0};
+}
+
+/**
+ * Fill with color the pixels matching the one at p
+ *
+ * With tolerance 0 and contiguous it works straight on the pixels, anything
+ * else compares whole rows with a ColorMatcher and works on the result.
+ */
+template<class PIXEL>
+inline SDL_Rect
+floodFillRows(SurfaceView<PIXEL> view,
+              const SDL_PixelFormat* format,
+              const SDL_Point& p,
+              const PIXEL& color,
+              int tolerance,
+              bool contiguous)
+{
+  const int WW = view.getW();
+  const int HH = view.getH();
+  auto rowAt = [&](int y) { return view.row(y); };
+  const PIXEL prevColor = view.at(p.x, p.y);
+  if (tolerance <= 0 && prevColor == color) { return {0, 0, 0, 0}; }
+  if (tolerance <= 0 && contiguous) {
+    auto fill = [&](int y, int x0, int x1) {
+      view.fill(x0, y, x1 - x0, color);
+    };
+    return floodFillSpans(WW, HH, p, prevColor, rowAt, fill);
+  }
+
+  ColorMatcher matcher{format, toRaw(prevColor), tolerance};
+  if (contiguous) {
+    // Rows are allocated and matched when first reached, filled cells are
+    // unmarked
+    std::vector<std::unique_ptr<Uint8[]>> mask(HH);
+    auto maskAt = [&](int y) {
+      auto& maskRow = mask[y];
+      if (!maskRow) {
+        maskRow.reset(new Uint8[WW]);
+        matcher(view.row(y), 0, WW, maskRow.get());
+      }
+      return maskRow.get();
+    };
+    auto fill = [&](int y, int x0, int x1) {
+      view.fill(x0, y, x1 - x0, color);
+      std::fill(maskAt(y) + x0, maskAt(y) + x1, 0);
+    };
+    return floodFillSpans(WW, HH, p, Uint8(1), maskAt, fill);
+  }
 
-    if (p.x > 0) stack.emplace_back(p.x - 1, p.y);
-    if (p.x < WW - 1) stack.emplace_back(p.x + 1, p.y);
-    if (p.y > 0) stack.emplace_back(p.x, p.y - 1);
-    if (p.y < HH - 1) stack.emplace_back(p.x, p.y + 1);
+  std::vector<Uint8> mask(WW);
+  int x0 = WW, y0 = HH, x1 = 0, y1 = 0;
+  for (int y = 0; y < HH; ++y) {
+    matcher(view.row(y), 0, WW, mask.data());
+    int x = findRunEnd<false>(mask.data(), 0, WW, Uint8(1));
+    while (x < WW) {
+      int runEnd = findRunEnd<true>(mask.data(), x, WW, Uint8(1));
+      view.fill(x, y, runEnd - x, color);
+      x0 = std::min(x0, x);
+      x1 = std::max(x1, runEnd);
+      y0 = std::min(y0, y);
+      y1 = y + 1;
+      x = findRunEnd<false>(mask.data(), runEnd, WW, Uint8(1));
+    }
   }
+  if (x0 >= x1) { return {0, 0, 0, 0}; }
+  return {x0, y0, x1 - x0, y1 - y0};
+}
+
+/**
+ * Fill the area around p with color
+ *
+ * @param tolerance how much each RGBA channel can differ from the color at p
+ * for a pixel to be filled too
+ * @param contiguous if false, every matching pixel on the surface is filled,
+ * not just those connected to p
+ * @return the bounding box of changed pixels
+ */
+inline SDL_Rect
+floodFill(Surface surface,
+          const SDL_Point& p,
+          RawColor color,
+          int tolerance = 0,
+          bool contiguous = true)
+{
+  const int WW = surface.getW();
+  const int HH = surface.getH();
+  if (p.x < 0 || p.y < 0 || p.x >= WW || p.y >= HH) { return {0, 0, 0, 0}; }
+
+  auto format = surface.getFormat();
+  return visitSurface(surface.get(), [&](auto view) {
+    using PIXEL = typename decltype(view)::Pixel;
+    auto pixel = toPixel<PIXEL>(color);
+    return floodFillRows(view, format, p, pixel, tolerance, contiguous);
+  });
 }
 
 struct FloodFillTool
@@ -41,9 +190,14 @@ struct FloodFillTool
   {
     if (event == PictureEvent::LEFT) {
       view.beginEdit();
-      floodFill(view.getBuffer()->getSurface(),
-                view.effectivePos(),
-                view.canvas.getRawColorA());
+      auto& buffer = *view.getBuffer();
+      auto dirty = floodFill(buffer.getSurface(),
+                             view.effectivePos(),
+                             view.canvas.getRawColorA(),
+                             view.fillTolerance,
+                             view.fillContiguous);
+      buffer.touch(dirty);
+      view.invalidatePreview(dirty);
       view.endEdit();
     } else if (event == PictureEvent::RIGHT) {
       view.pickColorUnderMouse();
@@ -0,0 +1,134 @@
+#include "ColorMatcher.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include "pixel.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace pixedit {
+
+static bool
+isByteAligned(Uint32 mask)
+{
+  return mask == 0 || mask == 0xFF || mask == 0xFF00 || mask == 0xFF'0000 ||
+         mask == 0xFF00'0000;
+}
+
+ColorMatcher::ColorMatcher(const SDL_PixelFormat* format,
+                           Uint32 color,
+                           int tolerance)
+  : format(format)
+  , color(color)
+  , channelMask(format->Rmask | format->Gmask | format->Bmask | format->Amask)
+  , tolerance(std::clamp(tolerance, 0, 255))
+{
+  SDL_GetRGBA(color, format, &rgba.r, &rgba.g, &rgba.b, &rgba.a);
+  if (format->BytesPerPixel == 4 && isByteAligned(format->Rmask) &&
+      isByteAligned(format->Gmask) && isByteAligned(format->Bmask) &&
+      isByteAligned(format->Amask)) {
+    kind = Kind::BYTES;
+  } else if (format->BytesPerPixel == 1 || format->BytesPerPixel == 2) {
+    kind = Kind::TABLE;
+    table.resize(size_t(1) << (8 * format->BytesPerPixel));
+    for (Uint32 value = 0; value < table.size(); ++value) {
+      SDL_Color other;
+      SDL_GetRGBA(value, format, &other.r, &other.g, &other.b, &other.a);
+      table[value] = isClose(other);
+    }
+  } else {
+    kind = Kind::GENERIC;
+  }
+}
+
+bool
+ColorMatcher::isClose(const SDL_Color& other) const
+{
+  return std::abs(rgba.r - other.r) <= tolerance &&
+         std::abs(rgba.g - other.g) <= tolerance &&
+         std::abs(rgba.b - other.b) <= tolerance &&
+         std::abs(rgba.a - other.a) <= tolerance;
+}
+
+/// @brief The 32 bits kernel, any byte order as long as channels are bytes
+static void
+matchBytes(const Uint32* src,
+           int count,
+           Uint32 color,
+           Uint32 channelMask,
+           int tolerance,
+           Uint8* out)
+{
+  int i = 0;
+  color &= channelMask;
+#ifdef __SSE2__
+  const __m128i ref = _mm_set1_epi32(color);
+  const __m128i care = _mm_set1_epi32(channelMask);
+  const __m128i tol = _mm_set1_epi8(char(tolerance));
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  // |a - b| <= tol on all bytes of a pixel, 16 pixels packed to 16 bytes
+  auto match4 = [&](const Uint32* p) {
+    __m128i px = _mm_and_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), care);
+    __m128i diff =
+      _mm_or_si128(_mm_subs_epu8(px, ref), _mm_subs_epu8(ref, px));
+    return _mm_cmpeq_epi32(_mm_subs_epu8(diff, tol), zero);
+  };
+  for (; i + 16 <= count; i += 16) {
+    __m128i lo = _mm_packs_epi32(match4(src + i), match4(src + i + 4));
+    __m128i hi = _mm_packs_epi32(match4(src + i + 8), match4(src + i + 12));
+    __m128i bytes = _mm_and_si128(_mm_packs_epi16(lo, hi), one);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+  }
+#endif
+  for (; i < count; ++i) {
+    Uint32 value = src[i] & channelMask;
+    bool close = true;
+    for (int shift = 0; shift < 32; shift += 8) {
+      int a = (value >> shift) & 0xFF;
+      int b = (color >> shift) & 0xFF;
+      close = close && std::abs(a - b) <= tolerance;
+    }
+    out[i] = close;
+  }
+}
+
+void
+ColorMatcher::operator()(const void* row, int x0, int x1, Uint8* out) const
+{
+  int count = x1 - x0;
+  if (count <= 0) return;
+  auto bytes = static_cast<const Uint8*>(row) + x0 * format->BytesPerPixel;
+  switch (kind) {
+  case Kind::BYTES:
+    matchBytes(reinterpret_cast<const Uint32*>(bytes),
+               count,
+               color,
+               channelMask,
+               tolerance,
+               out);
+    break;
+  case Kind::TABLE:
+    if (format->BytesPerPixel == 1) {
+      for (int i = 0; i < count; ++i) out[i] = table[bytes[i]];
+    } else {
+      auto src = reinterpret_cast<const Uint16*>(bytes);
+      for (int i = 0; i < count; ++i) out[i] = table[src[i]];
+    }
+    break;
+  case Kind::GENERIC:
+    for (int i = 0; i < count; ++i) {
+      auto value = getPixel(
+        const_cast<Uint8*>(bytes + i * format->BytesPerPixel),
+        format->BytesPerPixel);
+      SDL_Color other;
+      SDL_GetRGBA(value, format, &other.r, &other.g, &other.b, &other.a);
+      out[i] = isClose(other);
+    }
+    break;
+  }
+}
+
+} // namespace pixedit
@@ -0,0 +1,62 @@
+#ifndef PIXEDIT_SRC_UTILS_COLOR_MATCHER_INCLUDED
+#define PIXEDIT_SRC_UTILS_COLOR_MATCHER_INCLUDED
+
+#include <vector>
+#include <SDL.h>
+
+namespace pixedit {
+
+/**
+ * Tells which pixels of a row are close enough to a color
+ *
+ * Two colors are close if none of their RGBA channels differ by more than the
+ * tolerance. A tolerance of zero is an exact match of the channels.
+ *
+ * Formats with byte aligned channels in 32 bits are compared directly on the
+ * row, 16 bytes at a time with SSE2 where available. Formats of 8 and 16 bits
+ * use a table with the answer for each possible value. Anything else goes
+ * through SDL_GetRGBA() for each pixel.
+ */
+class ColorMatcher
+{
+  enum class Kind
+  {
+    BYTES,
+    TABLE,
+    GENERIC,
+  };
+
+  const SDL_PixelFormat* format;
+  Kind kind;
+  Uint32 color;
+  Uint32 channelMask;
+  SDL_Color rgba;
+  int tolerance;
+  std::vector<Uint8> table;
+
+public:
+  /**
+   * @param format the format of the rows to match
+   * @param color the raw color to look for, in format
+   * @param tolerance the max difference on any channel, from 0 to 255
+   */
+  ColorMatcher(const SDL_PixelFormat* format, Uint32 color, int tolerance);
+
+  /**
+   * Match pixels [x0, x1) of row
+   *
+   * @param row the start of the row
+   * @param x0 the first pixel
+   * @param x1 the pixel after the last
+   * @param out receives 1 for each pixel that matches, 0 for the others. It
+   * must have room for x1 - x0 values.
+   */
+  void operator()(const void* row, int x0, int x1, Uint8* out) const;
+
+private:
+  bool isClose(const SDL_Color& other) const;
+};
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_UTILS_COLOR_MATCHER_INCLUDED */
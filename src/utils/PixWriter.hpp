@@ -26,7 +26,7 @@ writePixImage(SDL_RWops* rw, SDL_Surface* surface)
   SDL_WriteLE32(rw, makeTag("FMT "));
   SDL_WriteLE32(rw, 8);
   SDL_WriteLE16(rw, format.w);
-  SDL_WriteLE16(rw, format.w);
+  SDL_WriteLE16(rw, format.h);
   SDL_WriteLE32(rw, format.pixel);
 
   SDL_WriteLE32(rw, makeTag("DATA"));
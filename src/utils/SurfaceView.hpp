@@ -0,0 +1,123 @@
+#ifndef PIXEDIT_SRC_UTILS_SURFACE_VIEW_INCLUDED
+#define PIXEDIT_SRC_UTILS_SURFACE_VIEW_INCLUDED
+
+#include <algorithm>
+#include <span>
+#include <type_traits>
+#include <SDL.h>
+#include "pixel.hpp"
+
+namespace pixedit {
+
+/**
+ * Typed access to the pixels of a surface
+ *
+ * PIXEL is Uint8, Uint16, Pixel24 or Uint32, matching the surface bytes per
+ * pixel. Nothing is bounds checked, so callers must clip first. Use
+ * visitSurface() to pick the right one once per operation, so the loops
+ * inside see plain arrays.
+ */
+template<class PIXEL>
+class SurfaceView
+{
+  Uint8* pixels;
+  const SDL_PixelFormat* format;
+  int pitch;
+  int w;
+  int h;
+
+public:
+  using Pixel = PIXEL;
+
+  explicit SurfaceView(SDL_Surface* surface)
+    : pixels(static_cast<Uint8*>(surface->pixels))
+    , format(surface->format)
+    , pitch(surface->pitch)
+    , w(surface->w)
+    , h(surface->h)
+  {
+  }
+
+  constexpr const SDL_PixelFormat* getFormat() const { return format; }
+
+  constexpr int getW() const { return w; }
+  constexpr int getH() const { return h; }
+
+  /// @brief True if (x, y) is inside the surface
+  constexpr bool contains(int x, int y) const
+  {
+    return x >= 0 && y >= 0 && x < w && y < h;
+  }
+
+  /// @brief The first pixel of row y
+  PIXEL* row(int y) const
+  {
+    return reinterpret_cast<PIXEL*>(pixels + y * pitch);
+  }
+
+  PIXEL& at(int x, int y) const { return row(y)[x]; }
+
+  /// @brief The pixels [x, x + len) of row y
+  std::span<PIXEL> span(int x, int y, int len) const
+  {
+    return {row(y) + x, size_t(len)};
+  }
+
+  /// @brief Set the pixels [x, x + len) of row y to value
+  void fill(int x, int y, int len, const PIXEL& value) const
+  {
+    std::fill_n(row(y) + x, len, value);
+  }
+};
+
+/// @brief Convert a raw color to PIXEL
+template<class PIXEL>
+constexpr PIXEL
+toPixel(Uint32 value)
+{
+  if constexpr (std::is_same_v<PIXEL, Pixel24>) {
+    PIXEL pixel{};
+    setPixel(pixel.bytes, value, 3);
+    return pixel;
+  } else {
+    return PIXEL(value);
+  }
+}
+
+/// @brief Convert a PIXEL to raw color
+template<class PIXEL>
+constexpr Uint32
+toRaw(PIXEL pixel)
+{
+  if constexpr (std::is_same_v<PIXEL, Pixel24>) {
+    return getPixel(pixel.bytes, 3);
+  } else {
+    return pixel;
+  }
+}
+
+/**
+ * Call callback with the SurfaceView matching the surface format
+ *
+ * @return what callback returned, or a value initialized one if the surface
+ * is null or its format has less than a byte per pixel.
+ */
+template<class CALLBACK>
+auto
+visitSurface(SDL_Surface* surface, CALLBACK callback)
+  -> decltype(callback(SurfaceView<Uint8>{surface}))
+{
+  using Result = decltype(callback(SurfaceView<Uint8>{surface}));
+  if (!surface) return Result();
+  switch (surface->format->BytesPerPixel) {
+  case 1: return callback(SurfaceView<Uint8>{surface});
+  case 2: return callback(SurfaceView<Uint16>{surface});
+  case 3: return callback(SurfaceView<Pixel24>{surface});
+  case 4: return callback(SurfaceView<Uint32>{surface});
+  default: return Result();
+  }
+}
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_UTILS_SURFACE_VIEW_INCLUDED */
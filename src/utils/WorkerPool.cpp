@@ -0,0 +1,75 @@
+#include "WorkerPool.hpp"
+#include <algorithm>
+
+namespace pixedit {
+
+WorkerPool::WorkerPool(unsigned threads)
+{
+  for (unsigned i = 1; i < threads; ++i) {
+    workers.emplace_back(&WorkerPool::work, this);
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard lock{mutex};
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto& worker : workers) worker.join();
+}
+
+void
+WorkerPool::run(int count, const std::function<void(int)>& task)
+{
+  if (count <= 0) return;
+  if (workers.empty() || count == 1) {
+    for (int i = 0; i < count; ++i) task(i);
+    return;
+  }
+  std::lock_guard job{running};
+  std::unique_lock lock{mutex};
+  this->task = &task;
+  this->count = count;
+  next = 0;
+  unfinished = count;
+  wake.notify_all();
+  drain(lock);
+  done.wait(lock, [&] { return unfinished == 0; });
+  this->task = nullptr;
+  this->count = 0;
+  next = 0;
+}
+
+WorkerPool&
+WorkerPool::shared()
+{
+  static WorkerPool pool{std::max(1u, std::thread::hardware_concurrency())};
+  return pool;
+}
+
+void
+WorkerPool::work()
+{
+  std::unique_lock lock{mutex};
+  for (;;) {
+    wake.wait(lock, [&] { return stopping || next < count; });
+    if (stopping) return;
+    drain(lock);
+  }
+}
+
+void
+WorkerPool::drain(std::unique_lock<std::mutex>& lock)
+{
+  while (next < count) {
+    int i = next++;
+    lock.unlock();
+    (*task)(i);
+    lock.lock();
+    if (--unfinished == 0) done.notify_all();
+  }
+}
+
+} // namespace pixedit
@@ -0,0 +1,58 @@
+#ifndef PIXEDIT_SRC_UTILS_WORKER_POOL_INCLUDED
+#define PIXEDIT_SRC_UTILS_WORKER_POOL_INCLUDED
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pixedit {
+
+/**
+ * A fixed set of threads to run the parts of a job in parallel
+ *
+ * The thread calling run() works on the parts too, so a pool of N threads
+ * has N - 1 workers. Only one job runs at a time; other callers wait for it.
+ */
+class WorkerPool
+{
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  std::vector<std::thread> workers;
+  const std::function<void(int)>* task = nullptr;
+  int count = 0;
+  int next = 0;
+  int unfinished = 0;
+  bool stopping = false;
+  std::mutex running;
+
+public:
+  /// @brief Create with the given number of threads, counting the caller
+  explicit WorkerPool(unsigned threads);
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  ~WorkerPool();
+
+  /// @brief The threads that work on a job, counting the caller
+  unsigned getThreadCount() const { return workers.size() + 1; }
+
+  /// @brief Call task(i) for each i in [0, count) and wait for all of them
+  void run(int count, const std::function<void(int)>& task);
+
+  /// @brief A pool with a thread per core, started on first use
+  static WorkerPool& shared();
+
+private:
+  void work();
+
+  /// @brief Take parts until none is left. Called with the lock held
+  void drain(std::unique_lock<std::mutex>& lock);
+};
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_UTILS_WORKER_POOL_INCLUDED */
@@ -0,0 +1,238 @@
+#include "blendRow.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEDIT_BLEND_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if PIXEDIT_BLEND_SSE2 && defined(__GNUC__) &&                                \
+  (defined(__x86_64__) || defined(__i386__))
+#define PIXEDIT_BLEND_AVX2 1
+#include <immintrin.h>
+#define PIXEDIT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace pixedit {
+
+namespace {
+
+using RowFunction = void (*)(Uint32*, const Uint32*, int);
+
+/// @brief The reference, one channel at a time
+struct ScalarKernel
+{
+  template<BlendMode MODE, int A>
+  static void row(Uint32* dst, const Uint32* src, int len)
+  {
+    for (int i = 0; i < len; ++i) {
+      Uint32 d = dst[i], s = src[i];
+      Uint8 sa = s >> A;
+      Uint32 result = 0;
+      for (int shift = 0; shift < 32; shift += 8) {
+        Uint8 c = shift == A
+                    ? blendChannel(d >> shift, 255, sa, BlendMode::SOURCE_OVER)
+                    : blendChannel(d >> shift, s >> shift, sa, MODE);
+        result |= Uint32(c) << shift;
+      }
+      dst[i] = result;
+    }
+  }
+};
+
+#if PIXEDIT_BLEND_SSE2
+// The vector kernels widen the bytes to 16 bits lanes, so a pixel takes four
+// of them, with alpha at lane A / 8. Each one is blendChannel() on all lanes
+// at once, with the alpha lanes forced to source over a white channel.
+
+/// @brief 4 pixels at a time
+struct Sse2Kernel
+{
+  static __m128i div255(__m128i x)
+  {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+  }
+
+  template<BlendMode MODE, int A>
+  static __m128i blend(__m128i d, __m128i s)
+  {
+    constexpr int L = A / 8;
+    const __m128i max = _mm_set1_epi16(255);
+    const __m128i alphaLanes = _mm_set_epi16(L == 3 ? 255 : 0,
+                                             L == 2 ? 255 : 0,
+                                             L == 1 ? 255 : 0,
+                                             L == 0 ? 255 : 0,
+                                             L == 3 ? 255 : 0,
+                                             L == 2 ? 255 : 0,
+                                             L == 1 ? 255 : 0,
+                                             L == 0 ? 255 : 0);
+    __m128i sa = _mm_shufflelo_epi16(s, _MM_SHUFFLE(L, L, L, L));
+    sa = _mm_shufflehi_epi16(sa, _MM_SHUFFLE(L, L, L, L));
+    __m128i t = s;
+    if constexpr (MODE == BlendMode::MULTIPLY) {
+      t = div255(_mm_mullo_epi16(s, d));
+    } else if constexpr (MODE == BlendMode::ADD) {
+      t = _mm_min_epi16(_mm_add_epi16(s, d), max);
+    }
+    t = _mm_or_si128(t, alphaLanes);
+    return div255(_mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(max, sa)),
+                                _mm_mullo_epi16(t, sa)));
+  }
+
+  template<BlendMode MODE, int A>
+  static void row(Uint32* dst, const Uint32* src, int len)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+      auto dp = reinterpret_cast<__m128i*>(dst + i);
+      __m128i d = _mm_loadu_si128(dp);
+      __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      __m128i lo = blend<MODE, A>(_mm_unpacklo_epi8(d, zero),
+                                  _mm_unpacklo_epi8(s, zero));
+      __m128i hi = blend<MODE, A>(_mm_unpackhi_epi8(d, zero),
+                                  _mm_unpackhi_epi8(s, zero));
+      _mm_storeu_si128(dp, _mm_packus_epi16(lo, hi));
+    }
+    ScalarKernel::row<MODE, A>(dst + i, src + i, len - i);
+  }
+};
+#endif
+
+#if PIXEDIT_BLEND_AVX2
+/// @brief 8 pixels at a time, the same steps as Sse2Kernel
+struct Avx2Kernel
+{
+  PIXEDIT_TARGET_AVX2 static __m256i div255(__m256i x)
+  {
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+  }
+
+  template<BlendMode MODE, int A>
+  PIXEDIT_TARGET_AVX2 static __m256i blend(__m256i d, __m256i s)
+  {
+    constexpr int L = A / 8;
+    constexpr short a0 = L == 0 ? 255 : 0, a1 = L == 1 ? 255 : 0,
+                    a2 = L == 2 ? 255 : 0, a3 = L == 3 ? 255 : 0;
+    const __m256i max = _mm256_set1_epi16(255);
+    const __m256i alphaLanes = _mm256_setr_epi16(
+      a0, a1, a2, a3, a0, a1, a2, a3, a0, a1, a2, a3, a0, a1, a2, a3);
+    __m256i sa = _mm256_shufflelo_epi16(s, _MM_SHUFFLE(L, L, L, L));
+    sa = _mm256_shufflehi_epi16(sa, _MM_SHUFFLE(L, L, L, L));
+    __m256i t = s;
+    if constexpr (MODE == BlendMode::MULTIPLY) {
+      t = div255(_mm256_mullo_epi16(s, d));
+    } else if constexpr (MODE == BlendMode::ADD) {
+      t = _mm256_min_epi16(_mm256_add_epi16(s, d), max);
+    }
+    t = _mm256_or_si256(t, alphaLanes);
+    return div255(
+      _mm256_add_epi16(_mm256_mullo_epi16(d, _mm256_sub_epi16(max, sa)),
+                       _mm256_mullo_epi16(t, sa)));
+  }
+
+  template<BlendMode MODE, int A>
+  PIXEDIT_TARGET_AVX2 static void row(Uint32* dst, const Uint32* src, int len)
+  {
+    // Unpacking and packing both work inside 128 bits halves, so the pixels
+    // come back in place
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+      auto dp = reinterpret_cast<__m256i*>(dst + i);
+      __m256i d = _mm256_loadu_si256(dp);
+      __m256i s =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+      __m256i lo = blend<MODE, A>(_mm256_unpacklo_epi8(d, zero),
+                                  _mm256_unpacklo_epi8(s, zero));
+      __m256i hi = blend<MODE, A>(_mm256_unpackhi_epi8(d, zero),
+                                  _mm256_unpackhi_epi8(s, zero));
+      _mm256_storeu_si256(dp, _mm256_packus_epi16(lo, hi));
+    }
+    Sse2Kernel::row<MODE, A>(dst + i, src + i, len - i);
+  }
+};
+#endif
+
+template<class KERNEL, BlendMode MODE>
+RowFunction
+pickRow(int alphaShift)
+{
+  switch (alphaShift) {
+  case 0: return &KERNEL::template row<MODE, 0>;
+  case 8: return &KERNEL::template row<MODE, 8>;
+  case 16: return &KERNEL::template row<MODE, 16>;
+  default: return &KERNEL::template row<MODE, 24>;
+  }
+}
+
+template<class KERNEL>
+RowFunction
+pickRow(BlendMode mode, int alphaShift)
+{
+  switch (mode) {
+  case BlendMode::MULTIPLY:
+    return pickRow<KERNEL, BlendMode::MULTIPLY>(alphaShift);
+  case BlendMode::ADD: return pickRow<KERNEL, BlendMode::ADD>(alphaShift);
+  default: return pickRow<KERNEL, BlendMode::SOURCE_OVER>(alphaShift);
+  }
+}
+
+} // namespace
+
+bool
+isSupported(BlendKernel kernel)
+{
+  switch (kernel) {
+  case BlendKernel::SCALAR: return true;
+#if PIXEDIT_BLEND_SSE2
+  case BlendKernel::SSE2: return true;
+#endif
+#if PIXEDIT_BLEND_AVX2
+  case BlendKernel::AVX2: {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+  }
+#endif
+  default: return false;
+  }
+}
+
+BlendKernel
+bestBlendKernel()
+{
+  static const BlendKernel best = isSupported(BlendKernel::AVX2)
+                                    ? BlendKernel::AVX2
+                                  : isSupported(BlendKernel::SSE2)
+                                    ? BlendKernel::SSE2
+                                    : BlendKernel::SCALAR;
+  return best;
+}
+
+void
+blendRow(Uint32* dst,
+         const Uint32* src,
+         int len,
+         BlendMode mode,
+         int alphaShift,
+         BlendKernel kernel)
+{
+  if (len <= 0) return;
+  if (mode == BlendMode::REPLACE) {
+    std::copy_n(src, len, dst);
+    return;
+  }
+  if (!isSupported(kernel)) kernel = BlendKernel::SCALAR;
+  RowFunction row = pickRow<ScalarKernel>(mode, alphaShift);
+#if PIXEDIT_BLEND_SSE2
+  if (kernel == BlendKernel::SSE2) row = pickRow<Sse2Kernel>(mode, alphaShift);
+#endif
+#if PIXEDIT_BLEND_AVX2
+  if (kernel == BlendKernel::AVX2) row = pickRow<Avx2Kernel>(mode, alphaShift);
+#endif
+  row(dst, src, len);
+}
+
+} // namespace pixedit
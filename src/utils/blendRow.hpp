@@ -0,0 +1,102 @@
+#ifndef PIXEDIT_SRC_UTILS_BLEND_ROW_INCLUDED
+#define PIXEDIT_SRC_UTILS_BLEND_ROW_INCLUDED
+
+#include <algorithm>
+#include <SDL.h>
+#include "BlendMode.hpp"
+#include "Color.hpp"
+
+namespace pixedit {
+
+/// @brief x / 255 rounded to nearest, for x up to 255 * 255
+constexpr Uint8
+div255(unsigned x)
+{
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+/**
+ * Blend a channel of the source, with alpha sa, on the destination one d
+ *
+ * This is the reference the vectorized kernels match bit for bit.
+ */
+constexpr Uint8
+blendChannel(Uint8 d, Uint8 s, Uint8 sa, BlendMode mode)
+{
+  unsigned t = s;
+  switch (mode) {
+  case BlendMode::REPLACE: return s;
+  case BlendMode::MULTIPLY: t = div255(s * d); break;
+  case BlendMode::ADD: t = std::min(s + d, 255); break;
+  default: break;
+  }
+  return div255(d * (255 - sa) + t * sa);
+}
+
+/// @brief Blend src on dst, the alpha always composited as source over
+constexpr Color
+blendColor(Color dst, Color src, BlendMode mode)
+{
+  if (mode == BlendMode::REPLACE) return src;
+  return {
+    blendChannel(dst.r, src.r, src.a, mode),
+    blendChannel(dst.g, src.g, src.a, mode),
+    blendChannel(dst.b, src.b, src.a, mode),
+    blendChannel(dst.a, 255, src.a, BlendMode::SOURCE_OVER),
+  };
+}
+
+/// @brief The code blendRow() runs on
+enum class BlendKernel
+{
+  SCALAR,
+  SSE2,
+  AVX2,
+};
+
+/// @brief If the kernel was built in and the CPU runs it
+bool
+isSupported(BlendKernel kernel);
+
+/// @brief The fastest kernel supported, checked once
+BlendKernel
+bestBlendKernel();
+
+/**
+ * Blend len 32 bits pixels of src on the ones of dst
+ *
+ * Every byte is a channel and the one at alphaShift is the alpha, the
+ * others are blended the same whatever color they are. An unsupported
+ * kernel falls back to SCALAR.
+ *
+ * @param alphaShift the bit offset of alpha in the pixel values: 0, 8, 16
+ * or 24
+ */
+void
+blendRow(Uint32* dst,
+         const Uint32* src,
+         int len,
+         BlendMode mode,
+         int alphaShift,
+         BlendKernel kernel = bestBlendKernel());
+
+/**
+ * The bit offset of alpha, when format is 32 bits with 8 bits channels
+ *
+ * Formats without alpha give their unused byte, otherwise -1.
+ */
+constexpr int
+alphaShiftOf(const SDL_PixelFormat* format)
+{
+  if (!format || format->BytesPerPixel != 4 || format->Rloss ||
+      format->Gloss || format->Bloss) {
+    return -1;
+  }
+  if (format->Amask) return format->Aloss ? -1 : format->Ashift;
+  return 48 - format->Rshift - format->Gshift - format->Bshift;
+}
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_UTILS_BLEND_ROW_INCLUDED */
@@ -5,6 +5,14 @@
 
 namespace pixedit {
 
+/// @brief A 3 bytes pixel, to work on 24 bits rows as arrays
+struct Pixel24
+{
+  Uint8 bytes[3];
+
+  constexpr bool operator==(const Pixel24&) const = default;
+};
+
 /**
  * Get raw pointer to pixel at pos
  *
@@ -29,9 +37,9 @@ getPixel(void* pixel, Uint8 bytesPerPixel)
     auto pixelPtr = static_cast<Uint8*>(pixel);
     Uint32 value = 0;
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
-    for (int i = 0; i < 3; i++) { value |= pixelPtr[i] >> i * 8; }
+    for (int i = 0; i < 3; i++) { value |= pixelPtr[i] << i * 8; }
 #else
-    for (int i = 0; i < 3; i++) { value |= pixelPtr[i] >> (2 - i) * 8; }
+    for (int i = 0; i < 3; i++) { value |= pixelPtr[i] << (2 - i) * 8; }
 #endif // SDL_BYTEORDER == SDL_LIL_ENDIAN
     return value;
   }
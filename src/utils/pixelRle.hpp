@@ -0,0 +1,91 @@
+#ifndef PIXEDIT_SRC_UTILS_PIXEL_RLE_INCLUDED
+#define PIXEDIT_SRC_UTILS_PIXEL_RLE_INCLUDED
+
+#include <cstring>
+#include <span>
+#include <vector>
+#include <SDL.h>
+
+namespace pixedit {
+
+/**
+ * Run length encode pixel data, appending to out
+ *
+ * It works on units of unitSz bytes (usually the bytes per pixel), so runs
+ * of equal pixels are detected even on multi byte formats. Each packet
+ * starts with a header byte. If its high bit is set, it is a run of
+ * `(header & 0x7F) + 1` copies of the single unit that follows. Otherwise it
+ * is a literal of `header + 1` units.
+ *
+ * @param data the data to encode. Its size must be a multiple of unitSz.
+ * @param unitSz the size of each unit, from 1 to 4.
+ * @param out where to append the result
+ */
+inline void
+encodeRle(std::span<const Uint8> data, int unitSz, std::vector<Uint8>& out)
+{
+  const size_t count = data.size() / unitSz;
+  const Uint8* src = data.data();
+  auto sameAt = [&](size_t i, size_t j) {
+    return memcmp(src + i * unitSz, src + j * unitSz, unitSz) == 0;
+  };
+  size_t i = 0;
+  while (i < count) {
+    size_t runEnd = i + 1;
+    while (runEnd < count && runEnd - i < 128 && sameAt(i, runEnd)) ++runEnd;
+    if (runEnd - i > 1) {
+      out.push_back(Uint8(0x80 | (runEnd - i - 1)));
+      out.insert(out.end(), src + i * unitSz, src + (i + 1) * unitSz);
+      i = runEnd;
+      continue;
+    }
+    size_t litEnd = i + 1;
+    while (litEnd < count && litEnd - i < 128 &&
+           !(litEnd + 1 < count && sameAt(litEnd, litEnd + 1))) {
+      ++litEnd;
+    }
+    out.push_back(Uint8(litEnd - i - 1));
+    out.insert(out.end(), src + i * unitSz, src + litEnd * unitSz);
+    i = litEnd;
+  }
+}
+
+/**
+ * Decode data encoded by encodeRle()
+ *
+ * @param data the encoded data
+ * @param unitSz the size of each unit, must be the same used to encode
+ * @param out the buffer to write to. It must be exactly the decoded size.
+ * @return true if the data decoded exactly to fill out.
+ */
+inline bool
+decodeRle(std::span<const Uint8> data, int unitSz, std::span<Uint8> out)
+{
+  const Uint8* src = data.data();
+  const Uint8* srcEnd = src + data.size();
+  Uint8* dst = out.data();
+  Uint8* dstEnd = dst + out.size();
+  while (src < srcEnd) {
+    Uint8 header = *src++;
+    size_t count = (header & 0x7F) + 1;
+    if (dst + count * unitSz > dstEnd) return false;
+    if (header & 0x80) {
+      if (src + unitSz > srcEnd) return false;
+      for (size_t i = 0; i < count; ++i, dst += unitSz) {
+        memcpy(dst, src, unitSz);
+      }
+      src += unitSz;
+    } else {
+      size_t sz = count * unitSz;
+      if (src + sz > srcEnd) return false;
+      memcpy(dst, src, sz);
+      src += sz;
+      dst += sz;
+    }
+  }
+  return dst == dstEnd;
+}
+
+} // namespace pixedit
+
+#endif /* PIXEDIT_SRC_UTILS_PIXEL_RLE_INCLUDED */
@@ -1,64 +1,182 @@
 #ifndef PIXEDIT_SRC_UTILS_RASTER_LINE_INCLUDED
 #define PIXEDIT_SRC_UTILS_RASTER_LINE_INCLUDED
 
+#include <algorithm>
+#include <climits>
 #include <concepts>
 #include <cstdlib>
+#include <utility>
+#include <SDL.h>
 
 namespace pixedit {
 
-/// @brief Implement half open line alorithm
+/// @brief A clip that lets any reasonable coordinate through
+constexpr SDL_Rect NO_CLIP{INT_MIN / 2, INT_MIN / 2, INT_MAX, INT_MAX};
+
+/**
+ * The half open line, only inside clip, as runs of pixels
+ *
+ * Calls callback(x, y, w, h) once per run, in the order of the line, with
+ * (x, y) the top left of the run. Shallow lines give horizontal runs, with
+ * h = 1, and steep ones vertical runs, with w = 1. The pixels are exactly
+ * the ones of rasterLineOpen(), which is built on this.
+ *
+ * The position at any step has a closed form, so the steps outside the clip
+ * are skipped and each run is found at once, instead of walked.
+ */
+template<std::invocable<int, int, int, int> CALLBACK>
+void
+rasterLineOpenRuns(int xBeg,
+                   int yBeg,
+                   int xEnd,
+                   int yEnd,
+                   const SDL_Rect& clip,
+                   CALLBACK callback)
+{
+  using Long = long long;
+  if (clip.w <= 0 || clip.h <= 0) return;
+  const int stepX = xEnd < xBeg ? -1 : 1;
+  const int stepY = yEnd < yBeg ? -1 : 1;
+  const Long deltaX = std::abs(Long(xEnd) - xBeg);
+  const Long deltaY = std::abs(Long(yEnd) - yBeg);
+
+  // The steps k where beg + k * step is in [lo, lo + len)
+  auto stepRange = [](Long beg, int step, Long lo, Long len) {
+    if (step > 0) return std::pair{lo - beg, lo + len - beg};
+    return std::pair{beg - lo - len + 1, beg - lo + 1};
+  };
+  auto [xLo, xHi] = stepRange(xBeg, stepX, clip.x, clip.w);
+  auto [yLo, yHi] = stepRange(yBeg, stepY, clip.y, clip.h);
+
+  const bool steep = deltaY > deltaX;
+  const Long major = steep ? deltaY : deltaX;
+  const Long minor = steep ? deltaX : deltaY;
+  const Long half = major / 2;
+  const Long minorLo = steep ? xLo : yLo;
+  const Long minorHi = steep ? xHi : yHi;
+  // The smallest m with k * minor - m * major <= half
+  auto minorAt = [&](Long k) -> Long {
+    Long excess = k * minor - half;
+    return excess > 0 ? (excess + major - 1) / major : 0;
+  };
+  // minorAt only grows, so the steps inside the minor range are contiguous
+  auto firstReaching = [&](Long lo, Long hi, Long m) {
+    while (lo < hi) {
+      Long mid = lo + (hi - lo) / 2;
+      if (minorAt(mid) >= m) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    return lo;
+  };
+  Long kBeg = std::max<Long>(0, steep ? yLo : xLo);
+  Long kEnd = std::min<Long>(major, steep ? yHi : xHi);
+  if (kBeg >= kEnd) return;
+  kBeg = firstReaching(kBeg, kEnd, minorLo);
+  kEnd = firstReaching(kBeg, kEnd, minorHi);
+
+  const Long majorBeg = steep ? yBeg : xBeg;
+  const int majorStep = steep ? stepY : stepX;
+  for (Long k = kBeg; k < kEnd;) {
+    // The run at m ends at the first step k with k * minor - half > m * major
+    const Long m = minorAt(k);
+    const Long next =
+      minor == 0 ? kEnd : std::min(kEnd, (m * major + half) / minor + 1);
+    const int len = int(next - k);
+    const Long top = majorStep > 0 ? k : next - 1;
+    const int first = int(majorBeg + majorStep * top);
+    if (steep) {
+      callback(int(xBeg + stepX * m), first, 1, len);
+    } else {
+      callback(first, int(yBeg + stepY * m), len, 1);
+    }
+    k = next;
+  }
+}
+
+/// @brief The half open line as runs, see the clipped overload
+template<std::invocable<int, int, int, int> CALLBACK>
+void
+rasterLineOpenRuns(int xBeg, int yBeg, int xEnd, int yEnd, CALLBACK callback)
+{
+  rasterLineOpenRuns(xBeg, yBeg, xEnd, yEnd, NO_CLIP, callback);
+}
+
+/// @brief Like rasterLineOpenRuns(), plus the end point as a run if in clip
+template<std::invocable<int, int, int, int> CALLBACK>
+void
+rasterLineRuns(int xBeg,
+               int yBeg,
+               int xEnd,
+               int yEnd,
+               const SDL_Rect& clip,
+               CALLBACK callback)
+{
+  rasterLineOpenRuns(xBeg, yBeg, xEnd, yEnd, clip, callback);
+  SDL_Point end{xEnd, yEnd};
+  if (SDL_PointInRect(&end, &clip)) callback(xEnd, yEnd, 1, 1);
+}
+
+/// @brief Implement half open line alorithm, only inside clip
 /// @tparam CALLBACK any callable that accepts two coordinates x, y;
 /// @param xBeg initial x
 /// @param yBeg initial y
 /// @param xEnd final x
 /// @param yEnd final
+/// @param clip only points inside it are given to callback
 /// @param callback the callback
 ///
 /// Line algorithm: https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
 template<std::invocable<int, int> CALLBACK>
 void
-rasterLineOpen(int xBeg, int yBeg, int xEnd, int yEnd, CALLBACK callback)
+rasterLineOpen(int xBeg,
+               int yBeg,
+               int xEnd,
+               int yEnd,
+               const SDL_Rect& clip,
+               CALLBACK callback)
 {
-  auto rasterOctant = [](int deltaX, int deltaY, auto callback) {
-    if (deltaY == 0) {
-      for (int x = 0; x < deltaX; ++x) callback(x, 0);
-      return;
-    }
-    int error = 0;
-    int y = 0;
-    for (int x = 0; x < deltaX; ++x) {
-      callback(x, y);
-      error += deltaY;
-      if (error > deltaX / 2) {
-        y++;
-        error -= deltaX;
+  const bool backX = xEnd < xBeg;
+  const bool backY = yEnd < yBeg;
+  rasterLineOpenRuns(
+    xBeg, yBeg, xEnd, yEnd, clip, [&](int x, int y, int w, int h) {
+      if (h == 1) {
+        for (int i = 0; i < w; ++i) callback(backX ? x + w - 1 - i : x + i, y);
+      } else {
+        for (int i = 0; i < h; ++i) callback(x, backY ? y + h - 1 - i : y + i);
       }
-    }
-  };
-  auto rasterQuadrant = [&](int deltaX, int deltaY, auto callback) {
-    if (deltaX >= deltaY) {
-      rasterOctant(deltaX, deltaY, callback);
-    } else {
-      rasterOctant(deltaY, deltaX, [&](int y, int x) { callback(x, y); });
-    }
-  };
+    });
+}
 
-  int deltaX = xEnd - xBeg, deltaY = yEnd - yBeg;
-  if (deltaY >= 0) {
-    if (deltaX >= 0)
-      rasterQuadrant(
-        deltaX, deltaY, [&](int x, int y) { callback(xBeg + x, yBeg + y); });
-    else
-      rasterQuadrant(
-        -deltaX, deltaY, [&](int x, int y) { callback(xBeg - x, yBeg + y); });
-  } else {
-    if (deltaX >= 0)
-      rasterQuadrant(
-        deltaX, -deltaY, [&](int x, int y) { callback(xBeg + x, yBeg - y); });
-    else
-      rasterQuadrant(
-        -deltaX, -deltaY, [&](int x, int y) { callback(xBeg - x, yBeg - y); });
-  }
+/// @brief Implement half open line alorithm
+/// @tparam CALLBACK any callable that accepts two coordinates x, y;
+/// @param xBeg initial x
+/// @param yBeg initial y
+/// @param xEnd final x
+/// @param yEnd final
+/// @param callback the callback
+template<std::invocable<int, int> CALLBACK>
+void
+rasterLineOpen(int xBeg, int yBeg, int xEnd, int yEnd, CALLBACK callback)
+{
+  rasterLineOpen(xBeg, yBeg, xEnd, yEnd, NO_CLIP, callback);
+}
+
+/// @brief Like rasterLineOpen(), but including the end point if in clip
+template<std::invocable<int, int> CALLBACK>
+void
+rasterLine(int xBeg,
+           int yBeg,
+           int xEnd,
+           int yEnd,
+           const SDL_Rect& clip,
+           CALLBACK callback)
+{
+  rasterLineOpen(xBeg, yBeg, xEnd, yEnd, clip, callback);
+  SDL_Point end{xEnd, yEnd};
+  if (SDL_PointInRect(&end, &clip)) callback(xEnd, yEnd);
 }
 
 template<std::invocable<int, int> CALLBACK>
@@ -9,50 +9,104 @@
 
 namespace pixedit {
 
+/**
+ * Call callback(x, y, len) for each span inside the polygon
+ *
+ * The edges are sorted by their top row once, and each row only looks at
+ * the edges crossing it, so the cost grows with the height plus the
+ * crossings instead of the height times the edges.
+ *
+ * Crossings are computed directly for each row, so rows outside clip are
+ * skipped without walking them.
+ *
+ * @param points the vertices as x, y pairs
+ * @param clip only the parts of spans inside it are given
+ */
 template<std::invocable<int, int, int> CALLBACK>
 void
-rasterPoly(std::span<const int> points, CALLBACK callback)
+rasterPoly(std::span<const int> points,
+           const SDL_Rect& clip,
+           CALLBACK callback)
 {
   auto count = points.size() / 2;
   if (count < 3) return;
+  struct Edge
+  {
+    int x1, y1, x2, y2; ///< y1 < y2
+  };
+  std::vector<Edge> edges;
+  edges.reserve(count);
   int minY = points[1], maxY = points[1];
-  for (size_t i = 1; i < count; ++i) {
-    int curr = points[i * 2 + 1];
-    if (curr < minY) minY = curr;
-    if (curr > maxY) maxY = curr;
+  for (size_t i = 0; i < count; ++i) {
+    int ind1 = i > 0 ? i - 1 : count - 1;
+    int x1 = points[ind1 * 2];
+    int y1 = points[ind1 * 2 + 1];
+    int x2 = points[i * 2];
+    int y2 = points[i * 2 + 1];
+    minY = std::min(minY, y2);
+    maxY = std::max(maxY, y2);
+    if (y1 == y2) continue;
+    if (y1 > y2) {
+      std::swap(x1, x2);
+      std::swap(y1, y2);
+    }
+    edges.push_back({x1, y1, x2, y2});
   }
+  std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+    return a.y1 < b.y1;
+  });
+
+  std::vector<Edge> active;
   std::vector<int> ints;
-  for (int y = minY; y <= maxY; ++y) {
+  auto nextEdge = edges.begin();
+  const int yBeg = std::max(minY, clip.y);
+  const int yEnd = int(std::min<long long>(maxY, clip.y + clip.h - 1ll));
+  const long long clipEnd = (long long)clip.x + clip.w;
+  for (int y = yBeg; y <= yEnd; ++y) {
+    for (; nextEdge != edges.end() && nextEdge->y1 <= y; ++nextEdge) {
+      active.push_back(*nextEdge);
+    }
+    // Edges own their top row but not their bottom one, except on the last
+    std::erase_if(active, [&](const Edge& e) {
+      return e.y2 < y || (e.y2 == y && y != maxY);
+    });
     ints.clear();
-    for (size_t i = 0; i < count; ++i) {
-      int ind1 = i > 0 ? i - 1 : count - 1;
-      int ind2 = i;
-      int x1 = points[ind1 * 2];
-      int y1 = points[ind1 * 2 + 1];
-      int x2 = points[ind2 * 2];
-      int y2 = points[ind2 * 2 + 1];
-      if (y1 > y2) {
-        std::swap(x1, x2);
-        std::swap(y1, y2);
-      } else if (y1 == y2) {
-        continue;
-      }
-      if (((y >= y1) && (y < y2)) || ((y == maxY) && (y > y1) && (y <= y2))) {
-        ints.push_back(((65536 * (y - y1)) / (y2 - y1)) * (x2 - x1) +
-                       (65536 * x1));
-      }
+    for (auto& e : active) {
+      ints.push_back(((65536 * (y - e.y1)) / (e.y2 - e.y1)) * (e.x2 - e.x1) +
+                     (65536 * e.x1));
     }
     std::sort(ints.begin(), ints.end());
-    for (size_t i = 0; i < ints.size(); i += 2) {
+    for (size_t i = 0; i + 1 < ints.size(); i += 2) {
       int xA = ints[i] + 1;
       xA = (xA >> 16) + ((xA & 32768) >> 15);
       int xB = ints[i + 1] - 1;
       xB = (xB >> 16) + ((xB & 32768) >> 15);
+      if (xA < clip.x || xB >= clipEnd) {
+        xA = std::max(xA, clip.x);
+        xB = int(std::min<long long>(xB, clipEnd - 1));
+        if (xA > xB) continue;
+      }
       callback(xA, y, xB - xA + 1);
     }
   }
 }
 
+template<std::invocable<int, int, int> CALLBACK>
+void
+rasterPoly(std::span<const int> points, CALLBACK callback)
+{
+  rasterPoly(points, NO_CLIP, callback);
+}
+
+template<std::invocable<int, int, int> CALLBACK>
+void
+rasterPoly(std::span<const SDL_Point> points,
+           const SDL_Rect& clip,
+           CALLBACK callback)
+{
+  rasterPoly(std::span{&points.front().x, points.size() * 2}, clip, callback);
+}
+
 template<std::invocable<int, int, int> CALLBACK>
 void
 rasterPoly(std::span<const SDL_Point> points, CALLBACK callback)
@@ -4,6 +4,8 @@
 #include <vector>
 #include <SDL.h>
 #include "Canvas.hpp"
+#include "CanvasCommandList.hpp"
+#include "SurfaceView.hpp"
 #include "primitives/Blit.hpp"
 #include "primitives/Poly.hpp"
 #include "primitives/Rect.hpp"
@@ -55,29 +57,36 @@ renderSelection(Canvas& canvas,
 inline void
 contour(Canvas& canvas, Surface mask, SDL_Point offset = {0, 0})
 {
-  constexpr static SDL_Point borders[] = {
-    {-1, -1},
-    {0, -1},
-    {1, -1},
-    {1, 0},
-    {1, 1},
-    {0, 1},
-    {-1, 1},
-    {-1, 0},
-  };
-  for (int y = 0; y < mask.getH(); ++y) {
-    for (int x = 0; x < mask.getW(); ++x) {
-      if (!mask.getPixel(x, y)) { continue; }
-      bool isCentral = true;
-      for (auto&& b : borders) {
-        if (!mask.getPixel(x + b.x, y + b.y)) {
-          isCentral = false;
-          break;
-        }
+  // The border comes a pixel at a time, so it is painted as merged spans
+  CanvasCommandList list;
+  bool batched = !canvas.isRecording();
+  if (batched) canvas.startRecording(list);
+  visitSurface(mask.get(), [&](auto view) {
+    using PIXEL = typename decltype(view)::Pixel;
+    const PIXEL none{};
+    const int WW = view.getW();
+    const int HH = view.getH();
+    for (int y = 0; y < HH; ++y) {
+      auto row = view.row(y);
+      bool inner = y > 0 && y < HH - 1;
+      auto above = inner ? view.row(y - 1) : row;
+      auto below = inner ? view.row(y + 1) : row;
+      for (int x = 0; x < WW; ++x) {
+        if (row[x] == none) { continue; }
+        // Pixels on the edge have neighbors outside, which count as unset
+        bool isCentral = inner && x > 0 && x < WW - 1 &&
+                         !(above[x - 1] == none || above[x] == none ||
+                           above[x + 1] == none || row[x - 1] == none ||
+                           row[x + 1] == none || below[x - 1] == none ||
+                           below[x] == none || below[x + 1] == none);
+        if (isCentral) { continue; }
+        canvas | Point(x + offset.x, y + offset.y);
       }
-      if (isCentral) { continue; }
-      canvas | Point(x + offset.x, y + offset.y);
     }
+  });
+  if (batched) {
+    canvas.stopRecording();
+    canvas | list;
   }
 }
 
@@ -1,9 +1,11 @@
 #include "replayPicture.hpp"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include "PictureView.hpp"
+#include "SurfaceView.hpp"
 
 namespace pixedit {
 
@@ -30,14 +32,18 @@ struct CommandEvaluator
 
   void evalData(std::istream& in, Surface s)
   {
-    Uint32 pixel = 0;
     in >> std::hex;
-    for (int y = 0; y < s.getH(); ++y) {
-      for (int x = 0; x < s.getW(); ++x) {
-        in >> pixel;
-        s.setPixel(x, y, pixel);
+    visitSurface(s.get(), [&](auto view) {
+      using PIXEL = typename decltype(view)::Pixel;
+      Uint32 pixel = 0;
+      for (int y = 0; y < view.getH(); ++y) {
+        auto row = view.row(y);
+        for (int x = 0; x < view.getW(); ++x) {
+          in >> pixel;
+          row[x] = toPixel<PIXEL>(pixel);
+        }
       }
-    }
+    });
     in >> std::dec;
   }
 
@@ -73,8 +79,48 @@ struct CommandEvaluator
       while (line.ends_with(' ')) { line.erase(line.size() - 1); }
       while (line.starts_with(' ')) { line.erase(0, 1); }
       load(line);
+    } else if (cmd == "TOOL") {
+      std::string id;
+      std::getline(sline >> std::ws, id);
+      view.setToolId(Id(id));
+    } else if (cmd == "COLOR") {
+      RawColor color = 0;
+      sline >> std::hex >> color;
+      view.canvas | RawColorA(color);
+    } else if (cmd == "COLOR_B") {
+      RawColor color = 0;
+      sline >> std::hex >> color;
+      view.canvas | RawColorB{color};
+    } else if (cmd == "PATTERN") {
+      Uint64 data = 0;
+      sline >> std::hex >> data;
+      view.canvas | Pattern{data};
+    } else if (cmd == "BLEND") {
+      sline >> cmd;
+      auto mode = BlendMode::REPLACE;
+      if (cmd == "OVER") {
+        mode = BlendMode::SOURCE_OVER;
+      } else if (cmd == "MULTIPLY") {
+        mode = BlendMode::MULTIPLY;
+      } else if (cmd == "ADD") {
+        mode = BlendMode::ADD;
+      }
+      view.canvas | mode;
+    } else if (cmd == "PEN") {
+      int w = 1, h = 1;
+      sline >> w >> h;
+      view.canvas | Pen(std::max(w, 1), std::max(h, 1));
+    } else if (cmd == "FILL") {
+      sline >> view.fillTolerance >> cmd;
+      view.fillContiguous = cmd != "GLOBAL";
     } else if (cmd == "FLUSH") {
       flush();
+    } else if (cmd == "FRAME") {
+      if (needsFlushing) {
+        flush();
+      } else {
+        view.update(nullptr);
+      }
     }
   }
 
@@ -0,0 +1,171 @@
+#include "catch.hpp"
+#include "Canvas.hpp"
+#include "primitives/Rect.hpp"
+#include "utils/blendRow.hpp"
+
+using namespace pixedit;
+
+SCENARIO("Drawing with a blend mode", "[canvas]")
+{
+  GIVEN("a Canvas on a 8x8 RGBA surface filled with an opaque color")
+  {
+    Uint32 background = 0x204060FF;
+    Uint32 pixels[8 * 8];
+    std::fill_n(pixels, 8 * 8, background);
+    auto surface = Surface{SDL_CreateRGBSurfaceFrom(pixels,
+                                                    8,
+                                                    8,
+                                                    32,
+                                                    8 * sizeof(Uint32),
+                                                    0xFF00'0000,
+                                                    0x00FF'0000,
+                                                    0x0000'FF00,
+                                                    0x0000'00FF),
+                           true};
+    Canvas canvas{surface};
+    WHEN("a half transparent red is painted over it")
+    {
+      canvas | RawColorA(0xFF00'0080) | BlendMode::SOURCE_OVER;
+      canvas | FillRectTo(0, 0, 2, 1);
+      THEN("the pixels are mixed and stay opaque")
+      {
+        REQUIRE(pixels[0] == 0x9020'30FF);
+        REQUIRE(pixels[10] == 0x9020'30FF);
+        REQUIRE(pixels[3] == background);
+        REQUIRE(pixels[16] == background);
+      }
+    }
+    WHEN("an opaque color is multiplied on it")
+    {
+      canvas | RawColorA(0x80FF'00FF) | BlendMode::MULTIPLY;
+      canvas | FillRectTo(0, 0, 7, 7);
+      THEN("the channels are scaled by the color")
+      {
+        REQUIRE(pixels[0] == 0x1040'00FF);
+        REQUIRE(pixels[63] == 0x1040'00FF);
+      }
+    }
+    WHEN("an opaque color is added to it")
+    {
+      canvas | RawColorA(0x1020'FFFF) | BlendMode::ADD;
+      canvas | FillRectTo(0, 0, 7, 7);
+      THEN("the channels are summed, saturating")
+      {
+        REQUIRE(pixels[0] == 0x3060'FFFF);
+        REQUIRE(pixels[63] == 0x3060'FFFF);
+      }
+    }
+    WHEN("a fully transparent color is painted over it")
+    {
+      canvas | RawColorA(0xFFFF'FF00) | BlendMode::SOURCE_OVER;
+      canvas | FillRectTo(0, 0, 7, 7);
+      THEN("nothing changes")
+      {
+        for (auto pixel : pixels) REQUIRE(pixel == background);
+      }
+    }
+    WHEN("the same color is used to replace it")
+    {
+      canvas | RawColorA(0xFF00'0080) | BlendMode::REPLACE;
+      canvas | FillRectTo(0, 0, 7, 7);
+      THEN("the pixels get the color, alpha included")
+      {
+        REQUIRE(pixels[0] == 0xFF00'0080);
+        REQUIRE(pixels[63] == 0xFF00'0080);
+      }
+    }
+    WHEN("a checkered pattern with a transparent color B is painted over")
+    {
+      canvas | RawColorA(0xFF00'0080) | RawColorB(0x0000'0000) |
+        patterns::CHECKERED | BlendMode::SOURCE_OVER;
+      canvas | FillRectTo(0, 0, 7, 7);
+      THEN("only the pixels of color A change")
+      {
+        REQUIRE(pixels[0] == 0x9020'30FF);
+        REQUIRE(pixels[1] == background);
+        REQUIRE(pixels[8] == background);
+        REQUIRE(pixels[9] == 0x9020'30FF);
+      }
+    }
+  }
+  GIVEN("a transparent surface")
+  {
+    Uint32 pixels[4] = {0};
+    auto surface = Surface{SDL_CreateRGBSurfaceFrom(pixels,
+                                                    4,
+                                                    1,
+                                                    32,
+                                                    4 * sizeof(Uint32),
+                                                    0xFF00'0000,
+                                                    0x00FF'0000,
+                                                    0x0000'FF00,
+                                                    0x0000'00FF),
+                           true};
+    Canvas canvas{surface};
+    WHEN("a half transparent red is painted over it")
+    {
+      canvas | RawColorA(0xFF00'0080) | BlendMode::SOURCE_OVER;
+      canvas | FillRectTo(0, 0, 3, 0);
+      THEN("the color gets its alpha, weighted")
+      {
+        REQUIRE(pixels[0] == 0x8000'0080);
+        REQUIRE(pixels[3] == 0x8000'0080);
+      }
+    }
+  }
+}
+
+SCENARIO("Blending wide patterned rects on different formats", "[canvas]")
+{
+  GIVEN("a surface with a gradient, in one of several formats")
+  {
+    auto format = GENERATE(SDL_PIXELFORMAT_ABGR8888,
+                           SDL_PIXELFORMAT_ARGB8888,
+                           SDL_PIXELFORMAT_RGBA8888,
+                           SDL_PIXELFORMAT_RGB24);
+    Surface surface{
+      SDL_CreateRGBSurfaceWithFormat(0, 100, 20, 32, format), true};
+    for (int y = 0; y < 20; ++y) {
+      for (int x = 0; x < 100; ++x) {
+        surface.setPixel(x,
+                         y,
+                         surface.mapColor({Uint8(x * 2),
+                                           Uint8(y * 12),
+                                           Uint8(255 - x),
+                                           Uint8(50 + x)}));
+      }
+    }
+    auto before = surface.clone();
+    Canvas canvas{surface};
+    auto mode = GENERATE(
+      BlendMode::SOURCE_OVER, BlendMode::MULTIPLY, BlendMode::ADD);
+    Color colorA{200, 100, 50, 180};
+    Color colorB{10, 250, 120, 60};
+    canvas | colorA | ColorB{colorB} | patterns::CHECKERED_2 | mode;
+    WHEN("a rect wider than a pattern run is filled off the 8 pixels grid")
+    {
+      canvas | FillRect(3, 2, 91, 15);
+      THEN("every pixel is the reference blend of its color")
+      {
+        auto fmt = surface.getFormat();
+        bool same = true;
+        for (int y = 0; y < 20; ++y) {
+          for (int x = 0; x < 100; ++x) {
+            auto dst = rawToComponent(before.getPixel(x, y), fmt);
+            bool inside = x >= 3 && x < 94 && y >= 2 && y < 17;
+            auto bits = patterns::CHECKERED_2.data8x8 >> (y % 8 * 8);
+            auto src = rawToComponent(
+              componentToRaw((bits >> (x % 8)) & 1 ? colorB : colorA, fmt),
+              fmt);
+            auto expected = inside ? blendColor(dst, src, mode) : dst;
+            auto actual = rawToComponent(surface.getPixel(x, y), fmt);
+            same = same && actual.r == expected.r &&
+                   actual.g == expected.g && actual.b == expected.b &&
+                   actual.a == expected.a;
+          }
+        }
+        REQUIRE(same);
+      }
+    }
+  }
+}
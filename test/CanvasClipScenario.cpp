@@ -0,0 +1,101 @@
+#include <vector>
+#include "catch.hpp"
+#include "Canvas.hpp"
+#include "primitives/Blit.hpp"
+#include "primitives/Lines.hpp"
+#include "primitives/Oval.hpp"
+#include "primitives/Poly.hpp"
+#include "primitives/Rect.hpp"
+
+using namespace pixedit;
+
+static void
+draw(Canvas& c, Surface stamp)
+{
+  std::vector<SDL_Point> vertices{{-20, 10}, {70, -5}, {40, 60}};
+  c | ColorA{255, 0, 0} | ColorB{0, 0, 255} | patterns::CHECKERED_4;
+  c | FillOval(-30, -10, 100, 40) | FillPoly(vertices);
+  c | Pattern{0} | ColorA{0, 255, 0} | Pen{4, 3};
+  c | LineTo(-50, 45, 90, 0) | OutlineOval(5, 5, 40, 30);
+  c | OutlineRect(12, 8, 30, 25) | Lines(vertices);
+  c | Blit{stamp, {15, 20}};
+  c | Pen{} | FillRect(0, 0, 60, 3);
+}
+
+SCENARIO("Drawing with a clip rect", "[canvas]")
+{
+  auto stamp = Surface::create(30, 6);
+  stamp.fillRect({0, 0, 30, 6}, 0x1234'56FF);
+  auto clipped = Surface::create(60, 48);
+  auto unclipped = Surface::create(60, 48);
+  clipped.fillRect({0, 0, 60, 48}, 0);
+  unclipped.fillRect({0, 0, 60, 48}, 0);
+  Canvas clippedCanvas{clipped};
+  Canvas unclippedCanvas{unclipped};
+  SDL_Rect clip = GENERATE(SDL_Rect{10, 12, 25, 20}, SDL_Rect{-5, 40, 100, 4});
+
+  GIVEN("a canvas with a clip rect")
+  {
+    clippedCanvas.setClipRect(clip);
+    WHEN("the same things are drawn with and without it")
+    {
+      draw(clippedCanvas, stamp);
+      draw(unclippedCanvas, stamp);
+      THEN("only the pixels inside the clip changed")
+      {
+        bool matches = true;
+        for (int y = 0; y < 48; ++y) {
+          for (int x = 0; x < 60; ++x) {
+            SDL_Point p{x, y};
+            Uint32 expected =
+              SDL_PointInRect(&p, &clip) ? unclipped.getPixel(x, y) : 0;
+            matches = matches && clipped.getPixel(x, y) == expected;
+          }
+        }
+        REQUIRE(matches);
+      }
+      THEN("the dirty rect is inside the clip")
+      {
+        auto dirty = clippedCanvas.getDirtyRect();
+        auto inside = clippedCanvas.getClipRect();
+        SDL_Rect both;
+        SDL_IntersectRect(&dirty, &inside, &both);
+        REQUIRE(SDL_RectEquals(&both, &dirty));
+      }
+    }
+    WHEN("the clip is reset")
+    {
+      clippedCanvas.resetClipRect();
+      draw(clippedCanvas, stamp);
+      draw(unclippedCanvas, stamp);
+      THEN("everything is drawn")
+      {
+        bool matches = true;
+        for (int y = 0; y < 48; ++y) {
+          for (int x = 0; x < 60; ++x) {
+            matches =
+              matches && clipped.getPixel(x, y) == unclipped.getPixel(x, y);
+          }
+        }
+        REQUIRE(matches);
+      }
+    }
+  }
+}
+
+SCENARIO("Drawing an oval from outside the canvas", "[canvas]")
+{
+  auto surface = Surface::create(20, 10);
+  surface.fillRect({0, 0, 20, 10}, 0);
+  Canvas canvas{surface};
+  canvas | ColorA{255, 0, 0} | Pen{1, 6};
+
+  GIVEN("a thin oval whose raster goes a row below its rect")
+  {
+    canvas | OutlineOval(12, -17, 1, 14);
+    THEN("the pen still reaches the canvas")
+    {
+      REQUIRE(surface.getPixel(12, 0) != 0);
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#include <vector>
+#include "catch.hpp"
+#include "Canvas.hpp"
+#include "CanvasCommandList.hpp"
+#include "primitives/Blit.hpp"
+#include "primitives/Lines.hpp"
+#include "primitives/Oval.hpp"
+#include "primitives/Rect.hpp"
+
+using namespace pixedit;
+
+/// @brief Overlapping primitives with different brushes, and a blit
+static void
+draw(Canvas& c, Surface stamp, BlendMode mode)
+{
+  std::vector<SDL_Point> vertices{{2, 30}, {40, 3}, {58, 40}};
+  c | mode | ColorA{255, 0, 0, 128} | ColorB{0, 0, 255} | patterns::CHECKERED_4;
+  c | FillRect(5, 5, 30, 20);
+  c | FillRect(20, 15, 30, 20);
+  c | Pattern{0} | ColorA{0, 255, 0} | Pen{3, 3} | Lines{vertices};
+  c | Blit{stamp, {20, 10}};
+  c | Pen{} | ColorA{255, 255, 0} | OutlineOval(10, 8, 40, 30);
+  for (int x = 0; x < 60; x += 2) c | SDL_Point{x, 44};
+}
+
+static bool
+sameSurface(Surface a, Surface b)
+{
+  for (int y = 0; y < a.getH(); ++y) {
+    for (int x = 0; x < a.getW(); ++x) {
+      if (a.getPixel(x, y) != b.getPixel(x, y)) return false;
+    }
+  }
+  return true;
+}
+
+SCENARIO("Recording and replaying a CanvasCommandList", "[canvas]")
+{
+  auto stamp = Surface::create(8, 8);
+  stamp.fillRect({0, 0, 8, 8}, 0x1234'56FF);
+  Uint32 format =
+    GENERATE(Uint32(Surface::DEFAULT_FORMAT), Uint32(SDL_PIXELFORMAT_RGB565));
+  auto mode = GENERATE(BlendMode::REPLACE,
+                       BlendMode::SOURCE_OVER,
+                       BlendMode::MULTIPLY,
+                       BlendMode::ADD);
+  auto make = [&] {
+    Surface s{SDL_CreateRGBSurfaceWithFormat(0, 60, 48, 32, format), true};
+    s.fillRect({0, 0, 60, 48}, s.mapColor({64, 128, 192, 255}));
+    return s;
+  };
+
+  GIVEN("a canvas recording into a list")
+  {
+    auto recorded = Surface::create(60, 48);
+    recorded.fillRect({0, 0, 60, 48}, 0);
+    Canvas recorder{recorded};
+    CanvasCommandList list;
+    recorder.startRecording(list);
+    draw(recorder, stamp, mode);
+    recorder.stopRecording();
+
+    THEN("nothing was painted")
+    {
+      auto blank = Surface::create(60, 48);
+      blank.fillRect({0, 0, 60, 48}, 0);
+      REQUIRE(sameSurface(recorded, blank));
+      REQUIRE(SDL_RectEmpty(&recorder.getDirtyRect()));
+      REQUIRE_FALSE(list.empty());
+    }
+    WHEN("it is replayed on two surfaces")
+    {
+      auto direct = make();
+      Canvas directCanvas{direct};
+      draw(directCanvas, stamp, mode);
+      auto preview = make();
+      auto buffer = make();
+      Canvas previewCanvas{preview};
+      Canvas bufferCanvas{buffer};
+      previewCanvas | list;
+      bufferCanvas | list;
+      THEN("both look as if drawn directly")
+      {
+        REQUIRE(sameSurface(preview, direct));
+        REQUIRE(sameSurface(buffer, direct));
+        auto a = previewCanvas.getDirtyRect();
+        auto b = directCanvas.getDirtyRect();
+        REQUIRE(SDL_RectEquals(&a, &b));
+      }
+    }
+  }
+}
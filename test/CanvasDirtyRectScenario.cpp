@@ -0,0 +1,65 @@
+#include "catch.hpp"
+#include "Canvas.hpp"
+#include "primitives/Line.hpp"
+#include "primitives/Point.hpp"
+#include "primitives/Rect.hpp"
+
+using namespace pixedit;
+
+static bool
+operator==(const SDL_Rect& lhs, const SDL_Rect& rhs)
+{
+  return SDL_RectEquals(&lhs, &rhs);
+}
+
+SCENARIO("Tracking the dirty rect", "[canvas]")
+{
+  GIVEN("a Canvas associated with a 8x8 surface")
+  {
+    Canvas canvas{Surface::create(8, 8)};
+    THEN("Nothing is dirty")
+    {
+      REQUIRE(SDL_RectEmpty(&canvas.getDirtyRect()));
+    }
+    WHEN("draw a point at (2x3)")
+    {
+      canvas | Point(2, 3);
+      THEN("Only the point is dirty")
+      {
+        REQUIRE(canvas.getDirtyRect() == SDL_Rect{2, 3, 1, 1});
+      }
+      AND_WHEN("draw a line from (5x1) to (4x6)")
+      {
+        canvas | LineTo(5, 1, 4, 6);
+        THEN("The dirty rect covers both")
+        {
+          REQUIRE(canvas.getDirtyRect() == SDL_Rect{2, 1, 4, 6});
+        }
+      }
+      AND_WHEN("the dirty rect is reset")
+      {
+        canvas.resetDirtyRect();
+        THEN("Nothing is dirty")
+        {
+          REQUIRE(SDL_RectEmpty(&canvas.getDirtyRect()));
+        }
+      }
+    }
+    WHEN("draw a point at (1x1) with a 3x3 pen")
+    {
+      canvas | Pen(3, 3) | Point(1, 1);
+      THEN("The pen area is dirty")
+      {
+        REQUIRE(canvas.getDirtyRect() == SDL_Rect{0, 0, 3, 3});
+      }
+    }
+    WHEN("fill a rect partially outside the surface")
+    {
+      canvas | FillRect({-2, 5, 4, 10});
+      THEN("The dirty rect is clipped to the surface")
+      {
+        REQUIRE(canvas.getDirtyRect() == SDL_Rect{0, 5, 2, 3});
+      }
+    }
+  }
+}
@@ -74,3 +74,38 @@ SCENARIO("Drawing a filled rectangle", "[canvas]")
     }
   }
 }
+
+SCENARIO("Drawing a wide patterned rectangle", "[canvas]")
+{
+  GIVEN("a Canvas on a 100x20 surface with a pattern")
+  {
+    auto surface = Surface::create(100, 20);
+    surface.fillRect({0, 0, 100, 20}, 0);
+    Canvas canvas{surface};
+    Uint32 colorA = 0xFFFF'FFFF, colorB = 0x0000'00FF;
+    Pattern pattern =
+      GENERATE(patterns::CHECKERED_4, Pattern{0x0123'4567'89AB'CDEF});
+    canvas | RawColorA(colorA) | RawColorB(colorB) | pattern;
+    WHEN("a rect not aligned to the pattern is filled")
+    {
+      SDL_Rect rect{3, 2, 90, 15};
+      canvas | rect;
+      THEN("every pixel follows the pattern at its position")
+      {
+        bool matches = true;
+        for (int y = 0; y < 20; ++y) {
+          for (int x = 0; x < 100; ++x) {
+            SDL_Point p{x, y};
+            Uint32 expected = 0;
+            if (SDL_PointInRect(&p, &rect)) {
+              bool bit = (pattern.data8x8 >> (y % 8 * 8 + x % 8)) & 1;
+              expected = bit ? colorB : colorA;
+            }
+            matches = matches && surface.getPixel(x, y) == expected;
+          }
+        }
+        REQUIRE(matches);
+      }
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#include <vector>
+#include "catch.hpp"
+#include "Canvas.hpp"
+#include "primitives/Oval.hpp"
+#include "primitives/Poly.hpp"
+#include "primitives/Rect.hpp"
+
+using namespace pixedit;
+
+SCENARIO("Filling in parallel bands", "[canvas]")
+{
+  GIVEN("a Canvas splitting every fill in bands and one that does not")
+  {
+    auto banded = Surface::create(120, 90);
+    auto serial = Surface::create(120, 90);
+    banded.fillRect({0, 0, 120, 90}, 0);
+    serial.fillRect({0, 0, 120, 90}, 0);
+    Canvas bandedCanvas{banded};
+    Canvas serialCanvas{serial};
+    bandedCanvas.setParallelFill({7, 0});
+    serialCanvas.setParallelFill({1, 0});
+    Pattern pattern = GENERATE(Pattern{0}, patterns::CHECKERED_4);
+    Pen pen = GENERATE(Pen{}, Pen{5, 3});
+    for (Canvas* c : {&bandedCanvas, &serialCanvas}) {
+      *c | RawColorA(0xFFFF'FFFF) | RawColorB(0x0000'00FF) | pattern | pen;
+    }
+
+    WHEN("a rect, an oval and a polygon are filled on both")
+    {
+      std::vector<SDL_Point> vertices{{60, 2}, {118, 80}, {5, 60}, {70, 50}};
+      for (Canvas* c : {&bandedCanvas, &serialCanvas}) {
+        *c | FillRect(-3, 10, 50, 70) | FillOval(30, 5, 80, 60) |
+          FillPoly(vertices);
+      }
+      THEN("they paint the same pixels and mark the same area")
+      {
+        bool same = true;
+        for (int y = 0; y < 90; ++y) {
+          for (int x = 0; x < 120; ++x) {
+            same = same && banded.getPixel(x, y) == serial.getPixel(x, y);
+          }
+        }
+        REQUIRE(same);
+        auto a = bandedCanvas.getDirtyRect();
+        auto b = serialCanvas.getDirtyRect();
+        REQUIRE(SDL_RectEquals(&a, &b));
+      }
+    }
+  }
+}
@@ -0,0 +1,172 @@
+#include "catch.hpp"
+#include "Canvas.hpp"
+#include "CanvasCommandList.hpp"
+#include "Stamp.hpp"
+#include "primitives/Line.hpp"
+#include "utils/rasterLine.hpp"
+
+using namespace pixedit;
+
+SCENARIO("Drawing with a stamp pen", "[canvas]")
+{
+  auto source = Surface::create(3, 2);
+  const Uint32 colorA = source.mapColor({255, 0, 0, 255});
+  const Uint32 colorB = source.mapColor({0, 255, 0, 255});
+  const Uint32 background = source.mapColor({128, 128, 128, 255});
+  GIVEN("a 3x2 stamp with a transparent pixel in each row")
+  {
+    source.setPixel(0, 0, colorA);
+    source.setPixel(1, 0, 0);
+    source.setPixel(2, 0, colorB);
+    source.setPixel(0, 1, colorA);
+    source.setPixel(1, 1, colorA);
+    source.setPixel(2, 1, source.mapColor({255, 255, 255, 0}));
+    Stamp stamp{source};
+
+    THEN("its opaque pixels are kept as runs")
+    {
+      auto row0 = stamp.getRuns(0);
+      REQUIRE(row0.size() == 2);
+      REQUIRE(row0[0].x == 0);
+      REQUIRE(row0[0].len == 1);
+      REQUIRE(row0[1].x == 2);
+      REQUIRE(row0[1].len == 1);
+      auto row1 = stamp.getRuns(1);
+      REQUIRE(row1.size() == 1);
+      REQUIRE(row1[0].x == 0);
+      REQUIRE(row1[0].len == 2);
+    }
+
+    AND_GIVEN("a canvas using it as pen")
+    {
+      auto surface = Surface::create(12, 10);
+      surface.fillRect({0, 0, 12, 10}, background);
+      Canvas canvas{surface};
+      canvas | Pen{stamp};
+      WHEN("a point is drawn")
+      {
+        canvas | SDL_Point{5, 5};
+        THEN("the stamp is put where a box pen as large would be")
+        {
+          REQUIRE(surface.getPixel(4, 5) == colorA);
+          REQUIRE(surface.getPixel(5, 5) == background);
+          REQUIRE(surface.getPixel(6, 5) == colorB);
+          REQUIRE(surface.getPixel(4, 6) == colorA);
+          REQUIRE(surface.getPixel(5, 6) == colorA);
+          REQUIRE(surface.getPixel(6, 6) == background);
+          REQUIRE(surface.getPixel(3, 5) == background);
+          REQUIRE(surface.getPixel(4, 4) == background);
+          auto dirty = canvas.getDirtyRect();
+          REQUIRE(dirty.x == 4);
+          REQUIRE(dirty.y == 5);
+          REQUIRE(dirty.w == 3);
+          REQUIRE(dirty.h == 2);
+        }
+      }
+      WHEN("a line is drawn")
+      {
+        canvas | LineTo{1, 2, 7, 3};
+        THEN("it is the same as stamping each of its points in order")
+        {
+          auto expected = Surface::create(12, 10);
+          expected.fillRect({0, 0, 12, 10}, background);
+          Canvas points{expected};
+          points | Pen{stamp};
+          rasterLine(1, 2, 7, 3, [&](int x, int y) {
+            points | SDL_Point{x, y};
+          });
+          bool same = true;
+          for (int y = 0; y < 10; ++y) {
+            for (int x = 0; x < 12; ++x) {
+              same =
+                same && surface.getPixel(x, y) == expected.getPixel(x, y);
+            }
+          }
+          REQUIRE(same);
+        }
+      }
+      WHEN("a point is drawn partly out of the clip rect and the surface")
+      {
+        canvas.setClipRect({5, 0, 12, 10});
+        canvas | SDL_Point{5, 0} | SDL_Point{11, 9};
+        THEN("only the visible pixels are changed")
+        {
+          REQUIRE(surface.getPixel(4, 0) == background);
+          REQUIRE(surface.getPixel(6, 0) == colorB);
+          REQUIRE(surface.getPixel(5, 1) == colorA);
+          REQUIRE(surface.getPixel(10, 9) == colorA);
+          REQUIRE(surface.getPixel(11, 9) == background);
+        }
+      }
+      WHEN("a point is recorded and replayed")
+      {
+        CanvasCommandList list;
+        canvas.startRecording(list);
+        canvas | SDL_Point{5, 5};
+        canvas.stopRecording();
+        THEN("nothing is painted until the list is")
+        {
+          REQUIRE(surface.getPixel(4, 5) == background);
+          canvas | list;
+          REQUIRE(surface.getPixel(4, 5) == colorA);
+          REQUIRE(surface.getPixel(5, 5) == background);
+          REQUIRE(surface.getPixel(6, 5) == colorB);
+        }
+      }
+    }
+  }
+  GIVEN("a stamp with translucent pixels")
+  {
+    source.fillRect({0, 0, 3, 2}, source.mapColor({255, 0, 0, 128}));
+    source.setPixel(1, 1, colorB);
+    Stamp stamp{source};
+    auto mode = GENERATE(BlendMode::REPLACE,
+                         BlendMode::SOURCE_OVER,
+                         BlendMode::MULTIPLY,
+                         BlendMode::ADD);
+    WHEN("a line is drawn directly and through a command list")
+    {
+      auto direct = Surface::create(12, 10);
+      direct.fillRect({0, 0, 12, 10}, background);
+      Canvas directCanvas{direct};
+      directCanvas | Pen{stamp} | mode;
+      directCanvas | LineTo{1, 2, 7, 3};
+
+      auto replayed = Surface::create(12, 10);
+      replayed.fillRect({0, 0, 12, 10}, background);
+      Canvas replayedCanvas{replayed};
+      replayedCanvas | Pen{stamp} | mode;
+      CanvasCommandList list;
+      replayedCanvas.startRecording(list);
+      replayedCanvas | LineTo{1, 2, 7, 3};
+      replayedCanvas.stopRecording();
+      replayedCanvas | list;
+      THEN("both give the same pixels")
+      {
+        bool same = true;
+        for (int y = 0; y < 10; ++y) {
+          for (int x = 0; x < 12; ++x) {
+            same = same && direct.getPixel(x, y) == replayed.getPixel(x, y);
+          }
+        }
+        REQUIRE(same);
+        REQUIRE(direct.getPixel(2, 2) != background);
+      }
+    }
+  }
+  GIVEN("a stamp with a color key")
+  {
+    auto keyed = Surface::create(2, 1);
+    keyed.setPixel(0, 0, colorA);
+    keyed.setPixel(1, 0, colorB);
+    keyed.setColorKey(colorB);
+    Stamp stamp{keyed};
+    THEN("the pixels of that color are transparent")
+    {
+      auto runs = stamp.getRuns(0);
+      REQUIRE(runs.size() == 1);
+      REQUIRE(runs[0].x == 0);
+      REQUIRE(runs[0].len == 1);
+    }
+  }
+}
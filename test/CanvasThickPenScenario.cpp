@@ -0,0 +1,116 @@
+#include <vector>
+#include "catch.hpp"
+#include "Canvas.hpp"
+#include "primitives/Lines.hpp"
+#include "primitives/Oval.hpp"
+#include "primitives/PenStroke.hpp"
+#include "primitives/Poly.hpp"
+#include "primitives/Rect.hpp"
+#include "utils/rasterLine.hpp"
+
+using namespace pixedit;
+
+/// @brief Paint the pen box at each point, as done before strokes existed
+static Surface
+boxesAt(const std::vector<SDL_Point>& points, const Pen& pen)
+{
+  auto surface = Surface::create(64, 48);
+  surface.fillRect({0, 0, 64, 48}, 0);
+  Canvas canvas{surface};
+  canvas | RawColorA(0xFFFF'FFFF) | pen;
+  for (auto p : points) canvas | p;
+  return surface;
+}
+
+static bool
+sameSurface(Surface a, Surface b)
+{
+  for (int y = 0; y < a.getH(); ++y) {
+    for (int x = 0; x < a.getW(); ++x) {
+      if (a.getPixel(x, y) != b.getPixel(x, y)) return false;
+    }
+  }
+  return true;
+}
+
+SCENARIO("Drawing with a thick pen", "[canvas]")
+{
+  GIVEN("a Canvas on a blank surface and a box pen")
+  {
+    auto surface = Surface::create(64, 48);
+    surface.fillRect({0, 0, 64, 48}, 0);
+    Canvas canvas{surface};
+    Pen pen = GENERATE(Pen{2, 3}, Pen{5, 5}, Pen{16, 7});
+    canvas | RawColorA(0xFFFF'FFFF) | pen;
+    std::vector<SDL_Point> points;
+    auto collect = [&](int x, int y) { points.push_back({x, y}); };
+
+    WHEN("a line is drawn")
+    {
+      auto [x2, y2] = GENERATE(std::pair{50, 10}, std::pair{12, 40});
+      canvas | LineTo(6, 8, x2, y2);
+      rasterLine(6, 8, x2, y2, collect);
+      THEN("it covers the pen box at every point of the line")
+      {
+        REQUIRE(sameSurface(surface, boxesAt(points, pen)));
+      }
+    }
+    WHEN("an open polyline is drawn")
+    {
+      std::vector<SDL_Point> vertices{{4, 4}, {40, 20}, {10, 30}, {60, 44}};
+      canvas | Lines(vertices);
+      for (size_t i = 1; i < vertices.size(); ++i) {
+        auto p1 = vertices[i - 1], p2 = vertices[i];
+        rasterLineOpen(p1.x, p1.y, p2.x, p2.y, collect);
+      }
+      points.push_back(vertices.back());
+      THEN("it covers the pen box at every point of the segments")
+      {
+        REQUIRE(sameSurface(surface, boxesAt(points, pen)));
+      }
+    }
+    WHEN("a rect outline is drawn")
+    {
+      canvas | OutlineRect(10, 8, 30, 20);
+      for (int x = 10; x < 40; ++x) {
+        points.push_back({x, 8});
+        points.push_back({x, 27});
+      }
+      for (int y = 9; y < 27; ++y) {
+        points.push_back({10, y});
+        points.push_back({39, y});
+      }
+      THEN("it covers the pen box at every point of the border")
+      {
+        REQUIRE(sameSurface(surface, boxesAt(points, pen)));
+      }
+    }
+    WHEN("an oval outline is drawn")
+    {
+      canvas | OutlineOval(8, 6, 41, 33);
+      rasterOvalOutline(8, 6, 41, 33, collect);
+      THEN("it covers the pen box at every point of the border")
+      {
+        REQUIRE(sameSurface(surface, boxesAt(points, pen)));
+      }
+    }
+  }
+}
+
+TEST_CASE("PenStroke spans", "[canvas]")
+{
+  PenStroke stroke{Pen{7, 4}};
+  rasterLine(0, 0, 30, 9, [&](int x, int y) { stroke.add(x, y); });
+  rasterLine(30, 0, 0, 9, [&](int x, int y) { stroke.add(x, y); });
+
+  int lastY = -100, lastEnd = 0;
+  bool sorted = true;
+  stroke.forEachSpan([&](int x, int y, int len) {
+    sorted = sorted && len > 0 &&
+             (y > lastY || (y == lastY && x > lastEnd));
+    lastY = y;
+    lastEnd = x + len;
+  });
+  // Sorted and apart, so no pixel is in two spans
+  REQUIRE(sorted);
+}
@@ -0,0 +1,132 @@
+#include "catch.hpp"
+#include "PictureView.hpp"
+#include "Stamp.hpp"
+#include "tools.hpp"
+
+using namespace pixedit;
+
+TEST_CASE("CommandLog", "[history]")
+{
+  auto buffer = std::make_shared<PictureBuffer>("", Surface::create(16, 16));
+  buffer->enableCommandLog();
+  REQUIRE(buffer->getCommandLog());
+  PictureView view{{0, 0, 16, 16}};
+  view.setBuffer(buffer);
+  view.update(nullptr);
+  view.setToolId(tools::FREE_HAND);
+  view.canvas | Color{255, 255, 255, 255};
+  auto stroke = [&](int x1, int y1, int x2, int y2) {
+    view.state.x = x1;
+    view.state.y = y1;
+    view.state.left = true;
+    view.update(nullptr);
+    view.state.x = x2;
+    view.state.y = y2;
+    view.update(nullptr);
+    view.state.left = false;
+    view.update(nullptr);
+  };
+  stroke(1, 1, 5, 1);
+  stroke(1, 3, 5, 3);
+  auto surface = buffer->getSurface();
+  auto white = surface.getPixel(3, 1);
+  REQUIRE(white != 0);
+  REQUIRE(surface.getPixel(3, 3) == white);
+  REQUIRE(buffer->getCommandLog()->size() == 2);
+  REQUIRE(buffer->getCommandLog()->getBytes() < 16 * 16 * 4 + 1024);
+
+  REQUIRE(view.undo());
+  view.update(nullptr);
+  REQUIRE(buffer->getSurface().getPixel(3, 1) == white);
+  REQUIRE(buffer->getSurface().getPixel(3, 3) == 0);
+  REQUIRE(view.undo());
+  view.update(nullptr);
+  REQUIRE(buffer->getSurface().getPixel(3, 1) == 0);
+  REQUIRE_FALSE(buffer->isDirty());
+
+  REQUIRE(view.redo());
+  REQUIRE(view.redo());
+  view.update(nullptr);
+  REQUIRE(buffer->getSurface().getPixel(3, 1) == white);
+  REQUIRE(buffer->getSurface().getPixel(5, 3) == white);
+
+  SECTION("Changes outside the input are kept as keyframes")
+  {
+    view.setSelection(Surface::create(2, 2));
+    view.persistSelection();
+    view.setToolId(tools::FREE_HAND);
+    stroke(1, 5, 5, 5);
+    REQUIRE(buffer->getCommandLog()->getBytes() >= 2 * 16 * 16 * 4);
+    REQUIRE(view.undo());
+    view.update(nullptr);
+    REQUIRE(buffer->getSurface().getPixel(3, 5) == 0);
+    REQUIRE(buffer->getSurface().getPixel(3, 3) == white);
+  }
+}
+
+TEST_CASE("CommandLog replays the blend mode", "[history]")
+{
+  auto buffer = std::make_shared<PictureBuffer>("", Surface::create(16, 16));
+  buffer->enableCommandLog();
+  PictureView view{{0, 0, 16, 16}};
+  view.setBuffer(buffer);
+  view.update(nullptr);
+  view.setToolId(tools::FREE_HAND);
+  auto stroke = [&](int x1, int y1, int x2, int y2) {
+    view.state.x = x1;
+    view.state.y = y1;
+    view.state.left = true;
+    view.update(nullptr);
+    view.state.x = x2;
+    view.state.y = y2;
+    view.update(nullptr);
+    view.state.left = false;
+    view.update(nullptr);
+  };
+  view.canvas | Color{100, 100, 100, 255};
+  stroke(1, 1, 5, 1);
+  view.canvas | BlendMode::ADD;
+  stroke(3, 0, 3, 4);
+  auto added = buffer->getSurface().getPixel(3, 1);
+  auto plain = buffer->getSurface().getPixel(3, 3);
+  REQUIRE(added != plain);
+
+  REQUIRE(view.undo());
+  view.update(nullptr);
+  REQUIRE(buffer->getSurface().getPixel(3, 1) == plain);
+  REQUIRE(view.redo());
+  view.update(nullptr);
+  REQUIRE(buffer->getSurface().getPixel(3, 1) == added);
+  REQUIRE(buffer->getSurface().getPixel(3, 3) == plain);
+}
+
+TEST_CASE("CommandLog keeps strokes of stamps", "[history]")
+{
+  auto buffer = std::make_shared<PictureBuffer>("", Surface::create(16, 16));
+  buffer->enableCommandLog();
+  PictureView view{{0, 0, 16, 16}};
+  view.setBuffer(buffer);
+  view.update(nullptr);
+  view.setToolId(tools::FREE_HAND);
+  auto source = Surface::create(3, 3);
+  source.setPixel(1, 1, source.mapColor({255, 0, 0, 255}));
+  Stamp stamp{source};
+  view.canvas | Pen{stamp};
+  view.state.x = 4;
+  view.state.y = 4;
+  view.state.left = true;
+  view.update(nullptr);
+  view.state.left = false;
+  view.update(nullptr);
+  auto red = buffer->getSurface().getPixel(4, 4);
+  REQUIRE(red != 0);
+  REQUIRE(buffer->getSurface().getPixel(3, 4) == 0);
+
+  REQUIRE(view.undo());
+  view.update(nullptr);
+  REQUIRE(buffer->getSurface().getPixel(4, 4) == 0);
+  REQUIRE(view.redo());
+  view.update(nullptr);
+  REQUIRE(buffer->getSurface().getPixel(4, 4) == red);
+  REQUIRE(buffer->getSurface().getPixel(3, 4) == 0);
+}
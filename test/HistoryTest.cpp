@@ -0,0 +1,167 @@
+#include "catch.hpp"
+#include "History.hpp"
+
+using namespace pixedit;
+
+TEST_CASE("History", "[history]")
+{
+  auto surface = Surface::create(100, 70);
+  surface.fillRect({0, 0, 100, 70}, 0x1111'11FF);
+  History history{1 << 20, 1 << 20};
+  history.reset(surface);
+  auto initialId = history.getStateId();
+  REQUIRE_FALSE(history.canUndo());
+  REQUIRE_FALSE(history.canRedo());
+
+  SECTION("Unchanged surface is not committed")
+  {
+    history.touchAll();
+    REQUIRE_FALSE(history.commit(surface));
+    REQUIRE(history.getStateId() == initialId);
+  }
+  SECTION("Undo and redo a change")
+  {
+    surface.setPixel(70, 65, 0xFF00'00FF);
+    history.touch({70, 65, 1, 1});
+    REQUIRE(history.commit(surface));
+    auto changedId = history.getStateId();
+    REQUIRE(changedId != initialId);
+
+    REQUIRE(history.undo(surface));
+    REQUIRE(surface.getPixel(70, 65) == 0x1111'11FF);
+    REQUIRE(history.getStateId() == initialId);
+    REQUIRE_FALSE(history.canUndo());
+
+    REQUIRE(history.redo(surface));
+    REQUIRE(surface.getPixel(70, 65) == 0xFF00'00FF);
+    REQUIRE(history.getStateId() == changedId);
+    REQUIRE_FALSE(history.canRedo());
+  }
+  SECTION("Restore discards uncommitted changes")
+  {
+    surface.fillRect({10, 10, 80, 50}, 0);
+    history.touch({10, 10, 80, 50});
+    history.restore(surface);
+    REQUIRE(surface.getPixel(10, 10) == 0x1111'11FF);
+    REQUIRE(surface.getPixel(89, 59) == 0x1111'11FF);
+  }
+  SECTION("Only touched regions are committed and restored")
+  {
+    surface.setPixel(1, 1, 0);
+    surface.setPixel(99, 69, 0);
+    history.touch({99, 69, 1, 1});
+    REQUIRE(history.commit(surface));
+    surface.setPixel(99, 69, 0x1111'11FF);
+    history.restore(surface);
+    REQUIRE(surface.getPixel(99, 69) == 0x1111'11FF);
+    REQUIRE(surface.getPixel(1, 1) == 0);
+    history.touch({0, 0, 2, 2});
+    history.restore(surface);
+    REQUIRE(surface.getPixel(1, 1) == 0x1111'11FF);
+  }
+  SECTION("Restore, undo and redo report the tiles they wrote")
+  {
+    surface.setPixel(70, 65, 0xFF00'00FF);
+    history.touch({70, 65, 1, 1});
+    REQUIRE(history.commit(surface));
+    SDL_Rect lastTile{64, 64, 36, 6};
+
+    history.touchAll();
+    auto restored = history.restore(surface);
+    REQUIRE(SDL_RectEmpty(&restored));
+    surface.setPixel(1, 1, 0);
+    history.touch({0, 0, 2, 2});
+    restored = history.restore(surface);
+    SDL_Rect firstTile{0, 0, 64, 64};
+    REQUIRE(SDL_RectEquals(&restored, &firstTile));
+
+    auto changed = history.undo(surface);
+    REQUIRE(changed);
+    REQUIRE(SDL_RectEquals(&*changed, &lastTile));
+    changed = history.redo(surface);
+    REQUIRE(changed);
+    REQUIRE(SDL_RectEquals(&*changed, &lastTile));
+    REQUIRE_FALSE(history.redo(surface));
+  }
+  SECTION("Commit after undo discards redo")
+  {
+    surface.setPixel(1, 1, 0);
+    history.touch({1, 1, 1, 1});
+    history.commit(surface);
+    history.undo(surface);
+    surface.setPixel(2, 2, 0);
+    history.touch({2, 2, 1, 1});
+    history.commit(surface);
+    REQUIRE_FALSE(history.canRedo());
+    history.undo(surface);
+    REQUIRE(surface.getPixel(1, 1) == 0x1111'11FF);
+    REQUIRE(surface.getPixel(2, 2) == 0x1111'11FF);
+  }
+  SECTION("Entries over memory budget are spilled to disk")
+  {
+    history.setMemoryBudget(0);
+    for (int i = 0; i < 3; ++i) {
+      surface.setPixel(i, 0, 0);
+      history.touch({i, 0, 1, 1});
+      history.commit(surface);
+    }
+    history.flush();
+    REQUIRE(history.getStats().entriesOnDisk == 3);
+    REQUIRE(history.getStats().bytesOnDisk > 0);
+    while (history.undo(surface)) {}
+    REQUIRE(surface.getPixel(0, 0) == 0x1111'11FF);
+    REQUIRE(history.getStats().diskHits == 3);
+    while (history.redo(surface)) {}
+    REQUIRE(surface.getPixel(2, 0) == 0);
+  }
+  SECTION("Oldest entries over disk budget are dropped")
+  {
+    history.setMemoryBudget(0);
+    surface.setPixel(0, 0, 0);
+    history.touch({0, 0, 1, 1});
+    history.commit(surface);
+    history.flush();
+    history.setDiskBudget(history.getStats().bytesOnDisk * 3 / 2);
+    for (int i = 1; i < 4; ++i) {
+      surface.setPixel(i, 0, 0);
+      history.touch({i, 0, 1, 1});
+      history.commit(surface);
+    }
+    history.flush();
+    REQUIRE(history.size() == 1);
+    REQUIRE(history.undo(surface));
+    REQUIRE_FALSE(history.canUndo());
+    REQUIRE(surface.getPixel(2, 0) == 0);
+    REQUIRE(surface.getPixel(3, 0) == 0x1111'11FF);
+  }
+  SECTION("Tiles with equal deltas are stored once")
+  {
+    surface = Surface::create(History::TILE_SIZE * 4, History::TILE_SIZE * 2);
+    history.reset(surface);
+    auto referenceBytes = history.getStats().bytesInRam;
+    surface.fillRect({0, 0, surface.getW(), surface.getH()}, 0x2222'22FF);
+    history.touchAll();
+    REQUIRE(history.commit(surface));
+    history.flush();
+    REQUIRE(history.getStats().bytesInRam - referenceBytes < 1024);
+
+    history.setMemoryBudget(0);
+    REQUIRE(history.undo(surface));
+    REQUIRE(surface.getPixel(255, 127) == 0);
+    REQUIRE(history.redo(surface));
+    REQUIRE(surface.getPixel(255, 127) == 0x2222'22FF);
+  }
+  SECTION("Geometry change")
+  {
+    surface = Surface::create(3, 3);
+    REQUIRE(history.commit(surface));
+    auto changed = history.undo(surface);
+    REQUIRE(changed);
+    REQUIRE(changed->w == 100);
+    REQUIRE(changed->h == 70);
+    REQUIRE(surface.getW() == 100);
+    REQUIRE(surface.getPixel(0, 0) == 0x1111'11FF);
+    REQUIRE(history.redo(surface));
+    REQUIRE(surface.getW() == 3);
+  }
+}
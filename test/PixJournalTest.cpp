@@ -0,0 +1,170 @@
+#include <filesystem>
+#include <fstream>
+#include "catch.hpp"
+#include "PictureBuffer.hpp"
+#include "utils/PixFormat.hpp"
+
+using namespace pixedit;
+
+TEST_CASE("PixJournal", "[history]")
+{
+  auto filename =
+    (std::filesystem::temp_directory_path() / "pixedit-journal-test.pix")
+      .string();
+  auto surface = Surface::create(100, 70);
+  surface.fillRect({0, 0, 100, 70}, 0x1111'11FF);
+  PictureBuffer buffer{filename, surface};
+  buffer.enableJournal();
+  auto paint = [&](int x, int y, Uint32 color) {
+    buffer.getSurface().setPixel(x, y, color);
+    buffer.touch({x, y, 1, 1});
+    buffer.makeSnapshot();
+  };
+  paint(1, 1, 0xFF00'00FF);
+  paint(99, 69, 0x00FF'00FF);
+  REQUIRE(buffer.save());
+  auto savedSize = std::filesystem::file_size(filename);
+
+  SECTION("Reopening restores the undo stack")
+  {
+    auto loaded = PictureBuffer::load(filename);
+    REQUIRE(loaded);
+    REQUIRE(loaded->hasJournal());
+    REQUIRE_FALSE(loaded->isDirty());
+    REQUIRE(loaded->getW() == 100);
+    REQUIRE(loaded->getH() == 70);
+    REQUIRE(loaded->getSurface().getPixel(99, 69) == 0x00FF'00FF);
+    REQUIRE(loaded->undo());
+    REQUIRE(loaded->getSurface().getPixel(99, 69) == 0x1111'11FF);
+    REQUIRE(loaded->getSurface().getPixel(1, 1) == 0xFF00'00FF);
+    REQUIRE(loaded->undo());
+    REQUIRE(loaded->getSurface().getPixel(1, 1) == 0x1111'11FF);
+    REQUIRE_FALSE(loaded->undo());
+    REQUIRE(loaded->redo());
+    REQUIRE(loaded->redo());
+    REQUIRE(loaded->getSurface().getPixel(99, 69) == 0x00FF'00FF);
+  }
+  SECTION("Saving new steps only appends them")
+  {
+    std::vector<char> before(savedSize);
+    std::ifstream{filename, std::ios::binary}.read(before.data(), savedSize);
+    paint(50, 35, 0x0000'FFFF);
+    REQUIRE(buffer.save());
+    auto newSize = std::filesystem::file_size(filename);
+    REQUIRE(newSize > savedSize);
+    REQUIRE(newSize - savedSize < 100 * 70 * 4 / 2);
+    std::vector<char> after(savedSize);
+    std::ifstream{filename, std::ios::binary}.read(after.data(), savedSize);
+    // Only the RIFF size changed
+    REQUIRE(std::equal(before.begin() + 8, before.end(), after.begin() + 8));
+
+    auto loaded = PictureBuffer::load(filename);
+    REQUIRE(loaded);
+    REQUIRE(loaded->getSurface().getPixel(50, 35) == 0x0000'FFFF);
+    REQUIRE(loaded->undo());
+    REQUIRE(loaded->undo());
+    REQUIRE(loaded->undo());
+    REQUIRE_FALSE(loaded->undo());
+  }
+  SECTION("Saving after an undo keeps the redo steps")
+  {
+    REQUIRE(buffer.undo());
+    REQUIRE(buffer.save());
+    auto loaded = PictureBuffer::load(filename);
+    REQUIRE(loaded);
+    REQUIRE(loaded->getSurface().getPixel(99, 69) == 0x1111'11FF);
+    REQUIRE(loaded->redo());
+    REQUIRE(loaded->getSurface().getPixel(99, 69) == 0x00FF'00FF);
+  }
+  SECTION("An interrupted append is ignored")
+  {
+    {
+      std::ofstream out{filename, std::ios::binary | std::ios::app};
+      out.write("DELT\x40\0\0\0\x02\0", 10);
+    }
+    auto loaded = PictureBuffer::load(filename);
+    REQUIRE(loaded);
+    REQUIRE(loaded->getSurface().getPixel(99, 69) == 0x00FF'00FF);
+    REQUIRE(loaded->undo());
+    REQUIRE(loaded->undo());
+    REQUIRE_FALSE(loaded->undo());
+
+    paint(50, 35, 0x0000'FFFF);
+    REQUIRE(buffer.save());
+    loaded = PictureBuffer::load(filename);
+    REQUIRE(loaded);
+    REQUIRE(loaded->getSurface().getPixel(50, 35) == 0x0000'FFFF);
+  }
+  SECTION("A step referring to a tile that is itself a reference is dropped")
+  {
+    std::vector<char> bytes(savedSize);
+    std::ifstream{filename, std::ios::binary}.read(bytes.data(), savedSize);
+    auto le32 = [&](size_t pos) {
+      return Uint32(Uint8(bytes[pos])) | Uint32(Uint8(bytes[pos + 1])) << 8 |
+             Uint32(Uint8(bytes[pos + 2])) << 16 |
+             Uint32(Uint8(bytes[pos + 3])) << 24;
+    };
+    auto put32 = [](std::vector<char>& out, Uint32 value) {
+      for (int i = 0; i < 4; ++i) out.push_back(char(value >> (8 * i)));
+    };
+    size_t pos = 12;
+    while (std::string_view(&bytes[pos], 4) != "DELT") {
+      pos += 8 + le32(pos + 4) + le32(pos + 4) % 2;
+    }
+    // Keep the first tile of the first step, then refer to it twice in chain
+    const size_t tile = pos + 12;
+    Uint32 index = le32(tile);
+    REQUIRE(le32(tile + 4) == Uint32(-1));
+    Uint32 dataSz = le32(tile + 8);
+    std::vector<char> delta;
+    put32(delta, 3);
+    put32(delta, index);
+    put32(delta, Uint32(-1));
+    put32(delta, dataSz);
+    delta.insert(delta.end(),
+                 bytes.begin() + tile + 12,
+                 bytes.begin() + tile + 12 + dataSz);
+    for (int sameAs : {0, 1}) {
+      put32(delta, index);
+      put32(delta, sameAs);
+      put32(delta, 0);
+    }
+    std::vector<char> chunks;
+    put32(chunks, makeTag("DELT"));
+    put32(chunks, delta.size());
+    chunks.insert(chunks.end(), delta.begin(), delta.end());
+    if (delta.size() % 2) chunks.push_back(0);
+    put32(chunks, makeTag("CHKP"));
+    put32(chunks, 2);
+    chunks.push_back(3);
+    chunks.push_back(0);
+    bytes.insert(bytes.end(), chunks.begin(), chunks.end());
+    std::vector<char> riffSize;
+    put32(riffSize, bytes.size() - 8);
+    std::copy(riffSize.begin(), riffSize.end(), bytes.begin() + 4);
+    std::ofstream{filename, std::ios::binary}.write(bytes.data(), bytes.size());
+
+    auto loaded = PictureBuffer::load(filename);
+    REQUIRE(loaded);
+    REQUIRE(loaded->getSurface().getPixel(99, 69) == 0x00FF'00FF);
+    REQUIRE(loaded->undo());
+    REQUIRE(loaded->undo());
+    REQUIRE_FALSE(loaded->undo());
+    REQUIRE(loaded->redo());
+    REQUIRE(loaded->redo());
+    REQUIRE_FALSE(loaded->redo());
+  }
+  SECTION("Files without a journal still load")
+  {
+    buffer.enableJournal(false);
+    paint(2, 2, 0);
+    REQUIRE(buffer.save());
+    auto loaded = PictureBuffer::load(filename);
+    REQUIRE(loaded);
+    REQUIRE_FALSE(loaded->hasJournal());
+    REQUIRE(loaded->getH() == 70);
+    REQUIRE(loaded->getSurface().getPixel(2, 2) == 0);
+    REQUIRE_FALSE(loaded->undo());
+  }
+  std::filesystem::remove(filename);
+}
@@ -0,0 +1,123 @@
+#include <vector>
+#include "catch.hpp"
+#include "tools/FloodFillTool.hpp"
+
+using namespace pixedit;
+
+/// @brief The straightforward 4-way fill, to check against
+static void
+referenceFill(Surface surface, SDL_Point p, Uint32 color)
+{
+  auto prevColor = surface.getPixel(p.x, p.y);
+  if (prevColor == color) return;
+  std::vector<SDL_Point> stack{p};
+  while (!stack.empty()) {
+    auto p = stack.back();
+    stack.pop_back();
+    if (p.x < 0 || p.y < 0 || p.x >= surface.getW() || p.y >= surface.getH())
+      continue;
+    if (surface.getPixel(p.x, p.y) != prevColor) continue;
+    surface.setPixel(p.x, p.y, color);
+    stack.push_back({p.x - 1, p.y});
+    stack.push_back({p.x + 1, p.y});
+    stack.push_back({p.x, p.y - 1});
+    stack.push_back({p.x, p.y + 1});
+  }
+}
+
+/// @brief Walls with gaps, pockets and a spiral, to exercise all span cases
+static void
+drawMaze(Surface surface, Uint32 wall)
+{
+  int w = surface.getW(), h = surface.getH();
+  for (int x = 3; x < w; x += 7) {
+    surface.fillRect({x, (x / 7) % 2 ? 0 : 4, 1, h - 4}, wall);
+  }
+  for (int y = 5; y < h; y += 9) { surface.fillRect({0, y, w / 2, 1}, wall); }
+  surface.fillRect({w - 20, h - 20, 15, 1}, wall);
+  surface.fillRect({w - 20, h - 20, 1, 15}, wall);
+  surface.fillRect({w - 20, h - 6, 15, 1}, wall);
+  surface.fillRect({w - 6, h - 16, 1, 11}, wall);
+  surface.fillRect({w - 16, h - 16, 10, 1}, wall);
+}
+
+static bool
+sameContents(const Surface& lhs, const Surface& rhs)
+{
+  for (int y = 0; y < lhs.getH(); ++y) {
+    for (int x = 0; x < lhs.getW(); ++x) {
+      if (lhs.getPixel(x, y) != rhs.getPixel(x, y)) return false;
+    }
+  }
+  return true;
+}
+
+TEST_CASE("floodFill", "[tools]")
+{
+  auto format = GENERATE(SDL_PIXELFORMAT_RGBA32,
+                         SDL_PIXELFORMAT_RGB24,
+                         SDL_PIXELFORMAT_RGB565,
+                         SDL_PIXELFORMAT_INDEX8);
+  auto surface = Surface::create(100, 70).cloneWith(format);
+  surface.fillRect({0, 0, 100, 70}, 0);
+  drawMaze(surface, 1);
+  auto expected = surface.clone();
+
+  SECTION("Fills the same pixels as a 4-way fill")
+  {
+    auto p = GENERATE(SDL_Point{0, 0}, SDL_Point{50, 35}, SDL_Point{99, 69});
+    referenceFill(expected, p, 2);
+    auto bounds = floodFill(surface, p, 2);
+    REQUIRE(sameContents(surface, expected));
+    bool inBounds = true;
+    for (int y = 0; y < 70; ++y) {
+      for (int x = 0; x < 100; ++x) {
+        SDL_Point point{x, y};
+        if (surface.getPixel(x, y) == 2) {
+          inBounds = inBounds && SDL_PointInRect(&point, &bounds);
+        }
+      }
+    }
+    REQUIRE(inBounds);
+  }
+  SECTION("Tolerance spreads to close colors")
+  {
+    auto wall = GENERATE(1, 2);
+    auto surface = Surface::create(40, 30);
+    surface.fillRect({0, 0, 40, 30}, 0x1010'10FF);
+    surface.fillRect({20, 0, 1, 30}, wall == 1 ? 0x1414'14FF : 0x8080'80FF);
+    surface.fillRect({30, 10, 5, 5}, 0x1212'12FF);
+    auto bounds = floodFill(surface, {0, 0}, 0x1313'13FF, 4);
+    auto right = surface.getPixel(32, 12);
+    REQUIRE(right == (wall == 1 ? 0x1313'13FF : 0x1212'12FF));
+    REQUIRE(surface.getPixel(20, 5) == (wall == 1 ? 0x1313'13FF : 0x8080'80FF));
+    REQUIRE(bounds.w == (wall == 1 ? 40 : 20));
+  }
+  SECTION("Non contiguous fill changes all matching pixels")
+  {
+    auto surface = Surface::create(40, 30);
+    surface.fillRect({0, 0, 40, 30}, 0x1010'10FF);
+    surface.fillRect({20, 0, 1, 30}, 0x8080'80FF);
+    surface.fillRect({30, 10, 5, 5}, 0x1111'11FF);
+    auto tolerance = GENERATE(0, 1);
+    auto bounds = floodFill(surface, {0, 0}, 0x8080'80FF, tolerance, false);
+    REQUIRE(surface.getPixel(39, 29) == 0x8080'80FF);
+    REQUIRE(surface.getPixel(32, 12) ==
+            (tolerance ? 0x8080'80FF : 0x1111'11FF));
+    REQUIRE(bounds.x == 0);
+    REQUIRE(bounds.w == 40);
+    REQUIRE(bounds.h == 30);
+  }
+  SECTION("Filling with the same color changes nothing")
+  {
+    auto bounds = floodFill(surface, {0, 0}, 0);
+    REQUIRE(SDL_RectEmpty(&bounds));
+    REQUIRE(sameContents(surface, expected));
+  }
+  SECTION("Points outside do nothing")
+  {
+    auto bounds = floodFill(surface, {100, 0}, 2);
+    REQUIRE(SDL_RectEmpty(&bounds));
+    REQUIRE(sameContents(surface, expected));
+  }
+}
@@ -0,0 +1,50 @@
+#include "catch.hpp"
+#include "Surface.hpp"
+#include "utils/SurfaceView.hpp"
+
+using namespace pixedit;
+
+TEST_CASE("SurfaceView", "[utils]")
+{
+  auto format = GENERATE(SDL_PIXELFORMAT_RGBA32,
+                         SDL_PIXELFORMAT_RGB24,
+                         SDL_PIXELFORMAT_RGB565,
+                         SDL_PIXELFORMAT_INDEX8);
+  auto surface = Surface::create(10, 5).cloneWith(format);
+  surface.fillRect({0, 0, 10, 5}, 0);
+
+  SECTION("Dispatches on the bytes per pixel")
+  {
+    int size = visitSurface(surface.get(), [](auto view) {
+      return int(sizeof(typename decltype(view)::Pixel));
+    });
+    REQUIRE(size == surface.getFormat()->BytesPerPixel);
+  }
+  SECTION("Writes are seen by the surface")
+  {
+    visitSurface(surface.get(), [](auto view) {
+      using PIXEL = typename decltype(view)::Pixel;
+      view.at(9, 4) = toPixel<PIXEL>(0x42);
+      view.fill(2, 1, 3, toPixel<PIXEL>(0x17));
+    });
+    REQUIRE(surface.getPixel(9, 4) == 0x42);
+    REQUIRE(surface.getPixel(1, 1) == 0);
+    REQUIRE(surface.getPixel(2, 1) == 0x17);
+    REQUIRE(surface.getPixel(4, 1) == 0x17);
+    REQUIRE(surface.getPixel(5, 1) == 0);
+  }
+  SECTION("Raw colors round trip")
+  {
+    Uint32 raw = surface.getFormat()->BytesPerPixel == 1 ? 0xAB : 0xABCD;
+    visitSurface(surface.get(), [&](auto view) {
+      using PIXEL = typename decltype(view)::Pixel;
+      REQUIRE(toRaw(toPixel<PIXEL>(raw)) == raw);
+    });
+  }
+  SECTION("Null surfaces are not visited")
+  {
+    bool visited = false;
+    visitSurface(nullptr, [&](auto) { visited = true; });
+    REQUIRE_FALSE(visited);
+  }
+}
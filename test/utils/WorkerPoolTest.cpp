@@ -0,0 +1,19 @@
+#include <atomic>
+#include <vector>
+#include "catch.hpp"
+#include "utils/WorkerPool.hpp"
+
+using namespace pixedit;
+
+TEST_CASE("WorkerPool", "[utils]")
+{
+  WorkerPool pool{4};
+  REQUIRE(pool.getThreadCount() == 4);
+  bool once = true;
+  for (int count : {0, 1, 3, 64, 1000}) {
+    std::vector<std::atomic<int>> calls(count);
+    pool.run(count, [&](int i) { ++calls[i]; });
+    for (auto& c : calls) once = once && c == 1;
+  }
+  REQUIRE(once);
+}
@@ -0,0 +1,85 @@
+#include "catch.hpp"
+#include <random>
+#include <vector>
+#include "utils/blendRow.hpp"
+
+using namespace pixedit;
+
+TEST_CASE("Blending channels", "[utils]")
+{
+  SECTION("div255 rounds to nearest")
+  {
+    bool exact = true;
+    for (unsigned x = 0; x <= 255 * 255; ++x) {
+      exact = exact && div255(x) == (x * 2 + 255) / 510;
+    }
+    REQUIRE(exact);
+  }
+  SECTION("Opaque colors cover and transparent ones leave it as is")
+  {
+    for (auto mode : {BlendMode::SOURCE_OVER, BlendMode::ADD}) {
+      REQUIRE(blendChannel(30, 200, 0, mode) == 30);
+    }
+    REQUIRE(blendChannel(30, 200, 255, BlendMode::SOURCE_OVER) == 200);
+    REQUIRE(blendChannel(30, 200, 255, BlendMode::ADD) == 230);
+    REQUIRE(blendChannel(100, 200, 255, BlendMode::ADD) == 255);
+    REQUIRE(blendChannel(30, 255, 255, BlendMode::MULTIPLY) == 30);
+    REQUIRE(blendChannel(30, 0, 255, BlendMode::MULTIPLY) == 0);
+  }
+  SECTION("Alpha is composited as source over")
+  {
+    Color c = blendColor({0, 0, 0, 0}, {255, 0, 0, 128}, BlendMode::MULTIPLY);
+    REQUIRE(c.a == 128);
+    c = blendColor({0, 0, 0, 255}, {255, 0, 0, 128}, BlendMode::ADD);
+    REQUIRE(c.a == 255);
+  }
+}
+
+TEST_CASE("Blending rows", "[utils]")
+{
+  auto kernel =
+    GENERATE(BlendKernel::SCALAR, BlendKernel::SSE2, BlendKernel::AVX2);
+  auto mode = GENERATE(
+    BlendMode::SOURCE_OVER, BlendMode::MULTIPLY, BlendMode::ADD);
+  int alphaShift = GENERATE(0, 8, 16, 24);
+  if (!isSupported(kernel)) return;
+
+  std::mt19937 random{1234};
+  std::vector<Uint32> dst(67), src(67);
+  for (auto& p : dst) p = random();
+  for (auto& p : src) p = random();
+  // Also the ends of the alpha range
+  src[1] &= ~(0xFFu << alphaShift);
+  src[2] |= 0xFFu << alphaShift;
+
+  SECTION("Every kernel gives the reference result, for any length")
+  {
+    bool same = true;
+    for (int len = 0; len <= 67; ++len) {
+      auto expected = dst;
+      auto actual = dst;
+      for (int i = 0; i < len; ++i) {
+        Uint8 sa = src[i] >> alphaShift;
+        Uint32 result = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+          Uint8 d = dst[i] >> shift, s = src[i] >> shift;
+          Uint8 c = shift == alphaShift
+                      ? blendChannel(d, 255, sa, BlendMode::SOURCE_OVER)
+                      : blendChannel(d, s, sa, mode);
+          result |= Uint32(c) << shift;
+        }
+        expected[i] = result;
+      }
+      blendRow(actual.data(), src.data(), len, mode, alphaShift, kernel);
+      same = same && actual == expected;
+    }
+    REQUIRE(same);
+  }
+  SECTION("Transparent pixels leave the row as is")
+  {
+    for (auto& p : src) p &= ~(0xFFu << alphaShift);
+    auto actual = dst;
+    blendRow(actual.data(), src.data(), 67, mode, alphaShift, kernel);
+    REQUIRE(actual == dst);
+  }
+}
@@ -0,0 +1,42 @@
+#include "catch.hpp"
+#include <vector>
+#include "utils/pixelRle.hpp"
+
+using namespace pixedit;
+
+TEST_CASE("Pixel RLE", "[utils]")
+{
+  std::vector<Uint8> encoded;
+  SECTION("Runs of multi byte units")
+  {
+    std::vector<Uint32> pixels(300, 0xAABBCCDD);
+    pixels[150] = 0;
+    pixels[151] = 1;
+    std::span<const Uint8> data{reinterpret_cast<Uint8*>(pixels.data()),
+                                pixels.size() * 4};
+    encodeRle(data, 4, encoded);
+    REQUIRE(encoded.size() < 40);
+
+    std::vector<Uint32> decoded(300);
+    REQUIRE(decodeRle(
+      encoded, 4, {reinterpret_cast<Uint8*>(decoded.data()), 300 * 4}));
+    REQUIRE(decoded == pixels);
+  }
+  SECTION("Literals")
+  {
+    std::vector<Uint8> data(1000);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = Uint8(i * 7);
+    encodeRle(data, 1, encoded);
+
+    std::vector<Uint8> decoded(1000);
+    REQUIRE(decodeRle(encoded, 1, decoded));
+    REQUIRE(decoded == data);
+  }
+  SECTION("Size mismatch is rejected")
+  {
+    std::vector<Uint8> data(10, 3);
+    encodeRle(data, 1, encoded);
+    std::vector<Uint8> decoded(9);
+    REQUIRE_FALSE(decodeRle(encoded, 1, decoded));
+  }
+}
@@ -1,5 +1,6 @@
 #include "catch.hpp"
 #include "utils/rasterLine.hpp"
+#include <algorithm>
 #include <tuple>
 #include <vector>
 
@@ -73,4 +74,134 @@ TEST_CASE("Test rasterLine", "[raster][line]")
     REQUIRE(points.at(1) == Point{9, 9});
     REQUIRE(points.at(2) == Point{8, 8});
   }
+  SECTION("Clipped lines only give the points inside, in order")
+  {
+    SDL_Rect clip{3, -2, 9, 7};
+    auto [x2, y2] = GENERATE(std::pair{20, 7},
+                             std::pair{-5, 13},
+                             std::pair{14, -9},
+                             std::pair{2, 30},
+                             std::pair{-17, -3});
+    PointVector expected;
+    rasterLine(4, 1, x2, y2, [&](int x, int y) {
+      SDL_Point p{x, y};
+      if (SDL_PointInRect(&p, &clip)) expected.emplace_back(x, y);
+    });
+    rasterLine(4, 1, x2, y2, clip, callback);
+    REQUIRE(points == expected);
+  }
+  SECTION("Lines far out of the clip give nothing")
+  {
+    rasterLineOpen(-100000, 5, 100000, 9, SDL_Rect{0, 20, 10, 10}, callback);
+    REQUIRE(points.empty());
+  }
+}
+
+/// @brief The plain Bresenham walk, to check the runs against
+static PointVector
+referenceLine(int x1, int y1, int x2, int y2)
+{
+  PointVector points;
+  int dx = std::abs(x2 - x1), dy = std::abs(y2 - y1);
+  int sx = x2 < x1 ? -1 : 1, sy = y2 < y1 ? -1 : 1;
+  bool steep = dy > dx;
+  int major = steep ? dy : dx, minor = steep ? dx : dy;
+  int error = 0, m = 0;
+  for (int k = 0; k < major; ++k) {
+    if (steep) {
+      points.emplace_back(x1 + sx * m, y1 + sy * k);
+    } else {
+      points.emplace_back(x1 + sx * k, y1 + sy * m);
+    }
+    error += minor;
+    if (error > major / 2) {
+      m++;
+      error -= major;
+    }
+  }
+  return points;
+}
+
+TEST_CASE("Test rasterLineRuns", "[raster][line]")
+{
+  std::vector<SDL_Rect> runs;
+  auto callback = [&](int x, int y, int w, int h) {
+    runs.push_back({x, y, w, h});
+  };
+  auto expand = [&] {
+    PointVector points;
+    for (auto& r : runs) {
+      for (int y = r.y; y < r.y + r.h; ++y) {
+        for (int x = r.x; x < r.x + r.w; ++x) points.emplace_back(x, y);
+      }
+    }
+    std::sort(points.begin(), points.end());
+    return points;
+  };
+  SECTION("Shallow lines give horizontal runs")
+  {
+    rasterLineOpenRuns(10, 10, 1, 12, callback);
+    REQUIRE(runs.size() == 3);
+    for (auto& r : runs) REQUIRE(r.h == 1);
+    REQUIRE(runs[0].x + runs[0].w == 11);
+    REQUIRE(runs[0].y == 10);
+    REQUIRE(runs[2].x == 2);
+    REQUIRE(runs[2].y == 12);
+  }
+  SECTION("Steep lines give vertical runs")
+  {
+    rasterLineOpenRuns(0, 0, 2, 20, callback);
+    REQUIRE(runs.size() == 3);
+    for (auto& r : runs) REQUIRE(r.w == 1);
+    REQUIRE(runs[0].y == 0);
+    REQUIRE(runs[2].y + runs[2].h == 20);
+  }
+  SECTION("Runs cover the same pixels as the plain walk")
+  {
+    bool same = true;
+    for (int x2 = -13; x2 <= 13; ++x2) {
+      for (int y2 = -13; y2 <= 13; ++y2) {
+        runs.clear();
+        rasterLineOpenRuns(0, 0, x2, y2, callback);
+        auto expected = referenceLine(0, 0, x2, y2);
+        std::sort(expected.begin(), expected.end());
+        same = same && expand() == expected;
+      }
+    }
+    REQUIRE(same);
+  }
+  SECTION("Points come in the order of the plain walk")
+  {
+    PointVector points;
+    bool same = true;
+    for (int x2 = -13; x2 <= 13; ++x2) {
+      for (int y2 = -13; y2 <= 13; ++y2) {
+        points.clear();
+        rasterLineOpen(
+          3, -2, x2, y2, [&](int x, int y) { points.emplace_back(x, y); });
+        same = same && points == referenceLine(3, -2, x2, y2);
+      }
+    }
+    REQUIRE(same);
+  }
+  SECTION("Clipped runs are the clipped pixels of the unclipped ones")
+  {
+    SDL_Rect clip{3, -2, 9, 7};
+    auto [x2, y2] = GENERATE(std::pair{40, 7},
+                             std::pair{-5, 13},
+                             std::pair{14, -29},
+                             std::pair{2, 30},
+                             std::pair{-37, -3});
+    PointVector expected;
+    for (auto [x, y] : referenceLine(4, 1, x2, y2)) {
+      SDL_Point p{x, y};
+      if (SDL_PointInRect(&p, &clip)) expected.emplace_back(x, y);
+    }
+    expected.emplace_back(x2, y2);
+    SDL_Point end{x2, y2};
+    if (!SDL_PointInRect(&end, &clip)) expected.pop_back();
+    std::sort(expected.begin(), expected.end());
+    rasterLineRuns(4, 1, x2, y2, clip, callback);
+    REQUIRE(expand() == expected);
+  }
 }
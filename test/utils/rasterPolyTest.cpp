@@ -18,4 +18,17 @@ TEST_CASE("Raster Poly", "[utils]")
     REQUIRE(hLines.at(0) == std::tuple{1, 0, 1});
     REQUIRE(hLines.at(1) == std::tuple{0, 1, 3});
   }
+  SECTION("Notched square (0,0)(6,0)(6,4)(4,4)(3,2)(2,4)(0,4)")
+  {
+    int points[] = {0, 0, 6, 0, 6, 4, 4, 4, 3, 2, 2, 4, 0, 4};
+    rasterPoly(points,
+               [&](int x, int y, int len) { hLines.emplace_back(x, y, len); });
+
+    REQUIRE(hLines.size() == 8);
+    REQUIRE(hLines.at(0) == std::tuple{0, 0, 7});
+    REQUIRE(hLines.at(1) == std::tuple{0, 1, 7});
+    REQUIRE(hLines.at(4) == std::tuple{0, 3, 3});
+    REQUIRE(hLines.at(5) == std::tuple{4, 3, 3});
+    REQUIRE(hLines.at(7) == std::tuple{4, 4, 3});
+  }
 }